@@ -18,6 +18,7 @@ SOURCES += \
     src/orn_plugin.cpp \
     src/orn.cpp \
     src/ornapirequest.cpp \
+    src/ornapicache.cpp \
     src/ornclient.cpp \
     src/ornabstractlistmodel.cpp \
     src/ornabstractappsmodel.cpp \
@@ -37,7 +38,9 @@ SOURCES += \
     src/ornbookmarksmodel.cpp \
     src/ornbackup.cpp \
     src/ornpm.cpp \
+    src/ornpktransaction.cpp \
     src/ornpackageversion.cpp \
+    src/orninstalledtable.cpp \
     src/orntagsmodel.cpp \
     src/orntaglistitem.cpp \
     src/orntagappsmodel.cpp
@@ -46,6 +49,7 @@ HEADERS += \
     src/orn_plugin.h \
     src/orn.h \
     src/ornapirequest.h \
+    src/ornapicache.h \
     src/ornclient.h \
     src/ornabstractlistmodel.h \
     src/ornabstractlistitem.h \
@@ -67,8 +71,10 @@ HEADERS += \
     src/ornbackup.h \
     src/ornpm.h \
     src/ornpm_p.h \
+    src/ornpktransaction.h \
     src/ornpackageversion.h \
     src/orninstalledpackage.h \
+    src/orninstalledtable.h \
     src/ornrepo.h \
     src/orntagsmodel.h \
     src/orntaglistitem.h \
@@ -1,4 +1,5 @@
 #include "orn.h"
+#include "ornapicache.h"
 
 #include <QJsonArray>
 #include <QJsonObject>
@@ -42,6 +43,7 @@ QNetworkAccessManager *networkAccessManager()
     if (!nam)
     {
         nam = new QNetworkAccessManager(qApp);
+        nam->setCache(new OrnApiCache(nam));
     }
     return nam;
 }
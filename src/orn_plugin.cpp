@@ -42,4 +42,5 @@ void OrnPlugin::registerTypes(const char *uri)
 
     qRegisterMetaType<QList<OrnInstalledPackage>>();
     qRegisterMetaType<QList<OrnPackageVersion>>();
+    qRegisterMetaType<OrnPackageVersionHash>();
 }
@@ -1,6 +1,9 @@
 #include "ornabstractlistmodel.h"
 #include "ornapirequest.h"
+#include "ornapicache.h"
+#include "orn.h"
 
+#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QDebug>
 
@@ -8,6 +11,7 @@ OrnAbstractListModel::OrnAbstractListModel(bool fetchable, QObject *parent) :
     QAbstractListModel(parent),
     mFetchable(fetchable),
     mCanFetchMore(true),
+    mRevalidating(false),
     mPage(0),
     mApiRequest(new OrnApiRequest(this))
 {
@@ -31,6 +35,8 @@ void OrnAbstractListModel::reset()
     auto d = mData;
     mData.clear();
     mCanFetchMore = true;
+    mRevalidating = false;
+    mCachedPage = QJsonArray();
     mPage = 0;
     mApiRequest->reset();
     mPrevReplyHash.clear();
@@ -39,8 +45,25 @@ void OrnAbstractListModel::reset()
     qDeleteAll(d);
 }
 
+/*!
+    Requests a page of the \a resource. The first page is shown from the cache
+    at once if it is available and is updated when a fresh reply arrives.
+ */
 void OrnAbstractListModel::apiCall(const QString &resource, QUrlQuery query)
 {
+    // Pages are fetched one by one, the first page could be waiting for a fresh reply
+    if (mApiRequest->running())
+    {
+        qDebug() << "Request is already running";
+        return;
+    }
+    if (mRevalidating)
+    {
+        qDebug() << "Could not revalidate the cached page";
+        mRevalidating = false;
+        mCachedPage = QJsonArray();
+    }
+
     auto url = OrnApiRequest::apiUrl(resource);
     if (mFetchable)
     {
@@ -51,9 +74,121 @@ void OrnAbstractListModel::apiCall(const QString &resource, QUrlQuery query)
         url.setQuery(query);
     }
     auto request = OrnApiRequest::networkRequest(url);
+
+    // An expired entry is not a hit, it is counted when the reply is revalidated
+    auto cache = qobject_cast<OrnApiCache *>(Orn::networkAccessManager()->cache());
+    if (mPage == 0 && mData.isEmpty() && cache)
+    {
+        auto metaData = cache->metaData(url);
+        auto device = metaData.isValid() ? cache->peek(url) : nullptr;
+        if (device)
+        {
+            auto jsonDoc = QJsonDocument::fromJson(device->readAll());
+            delete device;
+            if (jsonDoc.isArray() && !jsonDoc.array().isEmpty())
+            {
+                qDebug() << "Showing cached reply for" << url.toString();
+                this->onJsonReady(jsonDoc);
+                if (metaData.expirationDate() > QDateTime::currentDateTimeUtc())
+                {
+                    cache->countHit(url);
+                    return;
+                }
+                mRevalidating = true;
+                mCachedPage = jsonDoc.array();
+            }
+        }
+    }
+
     mApiRequest->run(request);
 }
 
+/*!
+    Updates the rows of the cached first page with a fresh reply. The pages
+    are compared item by item, so only the changed rows are inserted, removed
+    or updated.
+ */
+void OrnAbstractListModel::applyFreshPage(const QJsonDocument &jsonDoc,
+                                          const std::function<OrnAbstractListItem *(const QJsonObject &)> &create)
+{
+    mRevalidating = false;
+    auto freshPage = jsonDoc.array();
+    auto cachedPage = mCachedPage;
+    mCachedPage = QJsonArray();
+    if (freshPage.isEmpty())
+    {
+        qDebug() << "Fresh page is empty, the model has fetched all data";
+        mCanFetchMore = false;
+    }
+    if (freshPage == cachedPage)
+    {
+        qDebug() << "Cached page is up to date";
+        return;
+    }
+    if (mFetchable)
+    {
+        mPrevReplyHash = QCryptographicHash::hash(jsonDoc.toJson(), QCryptographicHash::Md5);
+    }
+
+    // The lengths of the common subsequences of the page tails
+    auto n = cachedPage.size();
+    auto m = freshPage.size();
+    QVector<int> lcs((n + 1) * (m + 1), 0);
+    auto at = [&lcs, m](int i, int j) -> int & { return lcs[i * (m + 1) + j]; };
+    for (int i = n - 1; i >= 0; --i)
+    {
+        for (int j = m - 1; j >= 0; --j)
+        {
+            at(i, j) = cachedPage[i] == freshPage[j] ?
+                        at(i + 1, j + 1) + 1 : qMax(at(i + 1, j), at(i, j + 1));
+        }
+    }
+
+    int i = 0, j = 0, row = 0;
+    int inserted = 0, removed = 0, changed = 0;
+    while (i < n || j < m)
+    {
+        if (i < n && j < m && cachedPage[i] == freshPage[j])
+        {
+            ++i;
+            ++j;
+            ++row;
+        }
+        else if (i < n && j < m && at(i, j) == at(i + 1, j + 1))
+        {
+            auto item = mData[row];
+            mData[row] = create(freshPage[j].toObject());
+            auto ind = this->createIndex(row, 0);
+            emit this->dataChanged(ind, ind);
+            delete item;
+            ++i;
+            ++j;
+            ++row;
+            ++changed;
+        }
+        else if (i < n && (j == m || at(i + 1, j) >= at(i, j + 1)))
+        {
+            this->beginRemoveRows(QModelIndex(), row, row);
+            auto item = mData.takeAt(row);
+            this->endRemoveRows();
+            delete item;
+            ++i;
+            ++removed;
+        }
+        else
+        {
+            this->beginInsertRows(QModelIndex(), row, row);
+            mData.insert(row, create(freshPage[j].toObject()));
+            this->endInsertRows();
+            ++j;
+            ++row;
+            ++inserted;
+        }
+    }
+    qDebug() << "Cached page updated:" << inserted << "inserted," << removed
+             << "removed," << changed << "changed";
+}
+
 int OrnAbstractListModel::rowCount(const QModelIndex &parent) const
 {
     return !parent.isValid() ? mData.size() : 0;
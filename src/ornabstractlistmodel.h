@@ -13,6 +13,8 @@
 
 #include <QDebug>
 
+#include <functional>
+
 class OrnApiRequest;
 
 class OrnAbstractListModel : public QAbstractListModel
@@ -37,6 +39,15 @@ protected:
     template<typename T>
     void processReply(const QJsonDocument &jsonDoc)
     {
+        if (mRevalidating)
+        {
+            this->applyFreshPage(jsonDoc, [](const QJsonObject &jsonObject)
+            {
+                return static_cast<OrnAbstractListItem *>(new T(jsonObject));
+            });
+            emit this->replyProcessed();
+            return;
+        }
         auto jsonArray = jsonDoc.array();
         if (jsonArray.size() > 0)
         {
@@ -84,11 +95,17 @@ protected slots:
     virtual void onJsonReady(const QJsonDocument &jsonDoc) = 0;
 
 protected:
+    void applyFreshPage(const QJsonDocument &jsonDoc,
+                        const std::function<OrnAbstractListItem *(const QJsonObject &)> &create);
+
     bool    mFetchable;
     bool    mCanFetchMore;
+    // The first page was shown from the cache and is waiting for a fresh reply
+    bool    mRevalidating;
     quint32 mPage;
     OrnItemList mData;
     OrnApiRequest *mApiRequest;
+    QJsonArray mCachedPage;
 
 private:
     QByteArray mPrevReplyHash;
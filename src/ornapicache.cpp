@@ -0,0 +1,225 @@
+#include "ornapicache.h"
+#include "ornapirequest.h"
+#include "orn.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QDateTime>
+#include <QMultiMap>
+#include <QRegularExpression>
+
+#include <QDebug>
+
+#define API_CACHE_DIR   QStringLiteral("apicache")
+#define API_CACHE_SIZE  (10 * 1024 * 1024)
+
+// Times to live in seconds, 0 means that a reply is revalidated on each request
+static const QList<QPair<QRegularExpression, int>> timesToLive{
+    { QRegularExpression(QStringLiteral("^categories$")),           24 * 60 * 60 },
+    { QRegularExpression(QStringLiteral("^tags/\\d+$")),            24 * 60 * 60 },
+    { QRegularExpression(QStringLiteral("^apps/\\d+(/compact)?$")), 10 * 60 },
+    { QRegularExpression(QStringLiteral("^apps/\\d+/comments$")),   0 },
+    { QRegularExpression(QStringLiteral("^comments/\\d+$")),        0 },
+    { QRegularExpression(QStringLiteral("^(\\w+/\\d+/)?apps$")),    5 * 60 },
+    { QRegularExpression(QStringLiteral("^search/apps$")),          5 * 60 }
+};
+
+OrnApiCache::OrnApiCache(QObject *parent)
+    : QNetworkDiskCache(parent)
+    , mUpdating(false)
+    , mHits(0)
+    , mMisses(0)
+{
+    this->setCacheDirectory(Orn::locate(API_CACHE_DIR));
+    this->setMaximumCacheSize(API_CACHE_SIZE);
+}
+
+quint32 OrnApiCache::hits() const
+{
+    return mHits;
+}
+
+quint32 OrnApiCache::misses() const
+{
+    return mMisses;
+}
+
+/*!
+    Returns the time to live in seconds for the API resource \a url
+    or -1 if the resource should not be cached.
+ */
+int OrnApiCache::timeToLive(const QUrl &url)
+{
+    auto prefix = OrnApiRequest::apiUrl(QString()).path();
+    auto path = url.path();
+    if (!path.startsWith(prefix))
+    {
+        return -1;
+    }
+    path.remove(0, prefix.size());
+    for (const auto &ttl : timesToLive)
+    {
+        if (ttl.first.match(path).hasMatch())
+        {
+            return ttl.second;
+        }
+    }
+    return -1;
+}
+
+/*!
+    Returns the cached data for the \a url without counting it as a hit.
+    Use it to check an entry which could be expired and revalidated later.
+ */
+QIODevice *OrnApiCache::peek(const QUrl &url)
+{
+    return QNetworkDiskCache::data(url);
+}
+
+/*!
+    Counts a hit for the \a url and marks the entry as recently used.
+ */
+void OrnApiCache::countHit(const QUrl &url)
+{
+    ++mHits;
+    mLastUsed.insert(url, QDateTime::currentMSecsSinceEpoch());
+    qDebug() << "API cache hit" << url.toString() << "- hits:" << mHits << "misses:" << mMisses;
+}
+
+QIODevice *OrnApiCache::data(const QUrl &url)
+{
+    auto device = QNetworkDiskCache::data(url);
+    if (device && !mUpdating)
+    {
+        this->countHit(url);
+    }
+    return device;
+}
+
+QIODevice *OrnApiCache::prepare(const QNetworkCacheMetaData &metaData)
+{
+    auto adjusted = this->adjustMetaData(metaData);
+    if (adjusted.saveToDisk() && !mUpdating)
+    {
+        ++mMisses;
+        mLastUsed.insert(metaData.url(), QDateTime::currentMSecsSinceEpoch());
+        qDebug() << "API cache miss" << metaData.url().toString() << "- hits:" << mHits << "misses:" << mMisses;
+    }
+    return QNetworkDiskCache::prepare(adjusted);
+}
+
+/*!
+    Called when a reply was revalidated, renews the time to live of the entry.
+ */
+void OrnApiCache::updateMetaData(const QNetworkCacheMetaData &metaData)
+{
+    // The base implementation rewrites the entry with data() and prepare()
+    mUpdating = true;
+    QNetworkDiskCache::updateMetaData(this->adjustMetaData(metaData));
+    mUpdating = false;
+}
+
+bool OrnApiCache::remove(const QUrl &url)
+{
+    mLastUsed.remove(url);
+    return QNetworkDiskCache::remove(url);
+}
+
+void OrnApiCache::clear()
+{
+    qDebug() << "Clearing API cache";
+    mLastUsed.clear();
+    QNetworkDiskCache::clear();
+}
+
+/*!
+    Removes the least recently used entries if the cache size exceeds the maximum.
+    Entries which were not used in this session are ordered by their file time.
+ */
+qint64 OrnApiCache::expire()
+{
+    struct Entry
+    {
+        QString path;
+        qint64 size;
+        qint64 time;
+    };
+
+    QList<Entry> entries;
+    qint64 total = 0;
+    QDirIterator it(this->cacheDirectory(), QStringList(QStringLiteral("*.d")),
+                    QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        auto info = it.fileInfo();
+        // Skip the entries which are being written
+        if (info.path().endsWith(QStringLiteral("/prepared")))
+        {
+            continue;
+        }
+        entries << Entry{ info.filePath(), info.size(), info.lastModified().toMSecsSinceEpoch() };
+        total += info.size();
+    }
+
+    auto limit = this->maximumCacheSize();
+    if (total <= limit)
+    {
+        return total;
+    }
+
+    QMultiMap<qint64, int> order;
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        const auto &e = entries[i];
+        auto url = this->fileMetaData(e.path).url();
+        order.insert(mLastUsed.value(url, e.time), i);
+    }
+
+    // Free some space to not expire on each insertion
+    auto goal = limit * 9 / 10;
+    int removed = 0;
+    for (auto i : order)
+    {
+        if (total <= goal)
+        {
+            break;
+        }
+        const auto &e = entries[i];
+        if (QFile::remove(e.path))
+        {
+            total -= e.size;
+            ++removed;
+        }
+    }
+    qDebug() << "Removed" << removed << "least recently used API cache entries";
+    return total;
+}
+
+/*!
+    Replaces the server cache headers with the time to live of the resource.
+ */
+QNetworkCacheMetaData OrnApiCache::adjustMetaData(const QNetworkCacheMetaData &metaData) const
+{
+    QNetworkCacheMetaData adjusted(metaData);
+    auto ttl = OrnApiCache::timeToLive(metaData.url());
+    if (ttl < 0)
+    {
+        adjusted.setSaveToDisk(false);
+        return adjusted;
+    }
+
+    QNetworkCacheMetaData::RawHeaderList headers;
+    for (const auto &header : metaData.rawHeaders())
+    {
+        auto name = header.first.toLower();
+        if (name != "cache-control" && name != "pragma" && name != "expires")
+        {
+            headers << header;
+        }
+    }
+    adjusted.setRawHeaders(headers);
+    adjusted.setExpirationDate(QDateTime::currentDateTimeUtc().addSecs(ttl));
+    adjusted.setSaveToDisk(true);
+    return adjusted;
+}
@@ -0,0 +1,53 @@
+#ifndef ORNAPICACHE_H
+#define ORNAPICACHE_H
+
+#include <QNetworkDiskCache>
+#include <QHash>
+
+/*!
+    A disk cache for the API replies.
+
+    Each resource gets its own time to live instead of the server cache headers.
+    Expired entries are revalidated by QNetworkAccessManager with ETag and
+    Last-Modified headers. When the cache exceeds its size the least recently
+    used entries are removed.
+ */
+class OrnApiCache : public QNetworkDiskCache
+{
+    Q_OBJECT
+
+public:
+    explicit OrnApiCache(QObject *parent = nullptr);
+
+    quint32 hits() const;
+    quint32 misses() const;
+
+    QIODevice *peek(const QUrl &url);
+    void countHit(const QUrl &url);
+
+    static int timeToLive(const QUrl &url);
+
+    // QAbstractNetworkCache interface
+public:
+    QIODevice *data(const QUrl &url);
+    QIODevice *prepare(const QNetworkCacheMetaData &metaData);
+    void updateMetaData(const QNetworkCacheMetaData &metaData);
+    bool remove(const QUrl &url);
+
+public slots:
+    void clear();
+
+protected:
+    qint64 expire();
+
+private:
+    QNetworkCacheMetaData adjustMetaData(const QNetworkCacheMetaData &metaData) const;
+
+    bool    mUpdating;
+    quint32 mHits;
+    quint32 mMisses;
+    // <url, msecs since epoch>
+    QHash<QUrl, qint64> mLastUsed;
+};
+
+#endif // ORNAPICACHE_H
@@ -6,35 +6,136 @@
 #include <QNetworkReply>
 #include <QJsonParseError>
 
+#define SHARED_USERS    "ornUsers"
+#define SHARED_JSON     "ornJson"
+
 const QString OrnApiRequest::apiUrlPrefix(QStringLiteral("https://openrepos.net/api/v1/"));
 const QByteArray OrnApiRequest::langName(QByteArrayLiteral("Accept-Language"));
 const QByteArray OrnApiRequest::langValue(QLocale::system().name().left(2).toUtf8());
 const QByteArray OrnApiRequest::platformName(QByteArrayLiteral("Warehouse-Platform"));
 const QByteArray OrnApiRequest::platformValue(QByteArrayLiteral("SailfishOS"));
 
+QHash<QByteArray, QNetworkReply *> OrnApiRequest::inFlight;
+
 OrnApiRequest::OrnApiRequest(QObject *parent)
     : QObject(parent)
-    , mNetworkReply(nullptr)
+    , mLastId(0)
 {}
 
 OrnApiRequest::~OrnApiRequest()
 {
-    if (mNetworkReply)
+    this->reset();
+}
+
+/*!
+    Starts a GET \a request and returns its id. The parsed reply is passed
+    to the \a callback if it is set or emitted with jsonReady() otherwise.
+ */
+quint32 OrnApiRequest::run(const QNetworkRequest &request, Callback callback)
+{
+    return this->track(OrnApiRequest::sharedGet(request), [this, callback](QNetworkReply *reply)
+    {
+        // The shared reply is parsed by sharedGet()
+        auto json = reply->property(SHARED_JSON);
+        if (!json.isValid())
+        {
+            return;
+        }
+        if (callback)
+        {
+            callback(json.toJsonDocument());
+        }
+        else
+        {
+            emit this->jsonReady(json.toJsonDocument());
+        }
+    });
+}
+
+/*!
+    Registers a \a reply and returns its id. The \a handler is called when
+    the reply is finished, then the reply is deleted.
+ */
+quint32 OrnApiRequest::track(QNetworkReply *reply, ReplyHandler handler)
+{
+    auto id = ++mLastId;
+    mReplies.insert(id, reply);
+    connect(reply, &QNetworkReply::finished, this, [this, id, reply, handler]()
     {
-        mNetworkReply->deleteLater();
+        mReplies.remove(id);
+        // Shared replies are deleted by sharedGet()
+        if (!reply->property(SHARED_USERS).isValid())
+        {
+            reply->deleteLater();
+        }
+        handler(reply);
+        emit this->requestFinished(id);
+    });
+    return id;
+}
+
+/*!
+    Returns a running reply for the same url and authorisation state
+    or starts a new one. The reply is parsed only once for all its users
+    and deleted after it is finished.
+ */
+QNetworkReply *OrnApiRequest::sharedGet(const QNetworkRequest &request)
+{
+    auto url = request.url();
+    QByteArray key(url.toEncoded());
+    key.append('\n').append(request.rawHeader(QByteArrayLiteral("X-CSRF-Token")));
+
+    auto reply = inFlight.value(key, nullptr);
+    if (reply)
+    {
+        qDebug() << "Attaching to the running request" << url.toString();
+        reply->setProperty(SHARED_USERS, reply->property(SHARED_USERS).toInt() + 1);
+        return reply;
     }
+
+    qDebug() << "Fetching data from" << url.toString();
+    reply = Orn::networkAccessManager()->get(request);
+    reply->setProperty(SHARED_USERS, 1);
+    inFlight.insert(key, reply);
+    // This connection is made before the users' ones so it is called first
+    QObject::connect(reply, &QNetworkReply::finished, [key, reply]()
+    {
+        if (inFlight.value(key, nullptr) == reply)
+        {
+            inFlight.remove(key);
+        }
+        reply->deleteLater();
+
+        if (reply->error() != QNetworkReply::NoError)
+        {
+            qDebug() << "Network request error" << reply->error()
+                     << "-" << reply->errorString();
+            return;
+        }
+
+        QJsonParseError error;
+        auto jsonDoc = QJsonDocument::fromJson(reply->readAll(), &error);
+        if (error.error != QJsonParseError::NoError)
+        {
+            qCritical() << "Could not parse reply:" << error.errorString();
+            return;
+        }
+        reply->setProperty(SHARED_JSON, QVariant::fromValue(jsonDoc));
+    });
+    return reply;
 }
 
-void OrnApiRequest::run(const QNetworkRequest &request)
+/*!
+    Detaches a user from the shared \a reply and aborts it if nobody needs it anymore.
+ */
+void OrnApiRequest::release(QNetworkReply *reply)
 {
-    if (mNetworkReply)
+    auto users = reply->property(SHARED_USERS).toInt() - 1;
+    reply->setProperty(SHARED_USERS, users);
+    if (users <= 0 && reply->isRunning())
     {
-        qDebug() << "Request is already running";
-        return;
+        reply->abort();
     }
-    qDebug() << "Fetching data from" << request.url().toString();
-    mNetworkReply = Orn::networkAccessManager()->get(request);
-    connect(mNetworkReply, &QNetworkReply::finished, this, &OrnApiRequest::onReplyFinished);
 }
 
 QNetworkRequest OrnApiRequest::networkRequest(const QUrl &url)
@@ -51,35 +152,30 @@ QNetworkRequest OrnApiRequest::networkRequest(const QUrl &url)
     return request;
 }
 
-void OrnApiRequest::reset()
+void OrnApiRequest::cancel(quint32 id)
 {
-    if (mNetworkReply)
+    auto reply = mReplies.take(id);
+    if (!reply)
     {
-        mNetworkReply->deleteLater();
-        mNetworkReply = nullptr;
+        return;
     }
-}
-
-void OrnApiRequest::onReplyFinished()
-{
-    if (mNetworkReply->error() != QNetworkReply::NoError)
+    qDebug() << "Cancelling request" << id;
+    QObject::disconnect(reply, nullptr, this, nullptr);
+    if (reply->property(SHARED_USERS).isValid())
     {
-        qDebug() << "Network request error" << mNetworkReply->error()
-                 << "-" << mNetworkReply->errorString();
-        this->reset();
-        return;
+        OrnApiRequest::release(reply);
     }
-
-    QJsonParseError error;
-    auto jsonDoc = QJsonDocument::fromJson(mNetworkReply->readAll(), &error);
-    if (error.error != QJsonParseError::NoError)
+    else
     {
-        qCritical() << "Could not parse reply:" << error.errorString();
-        this->reset();
-        return;
+        reply->abort();
+        reply->deleteLater();
     }
+}
 
-    emit this->jsonReady(jsonDoc);
-
-    this->reset();
+void OrnApiRequest::reset()
+{
+    for (auto id : mReplies.keys())
+    {
+        this->cancel(id);
+    }
 }
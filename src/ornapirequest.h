@@ -3,6 +3,9 @@
 
 #include <QObject>
 #include <QUrl>
+#include <QHash>
+
+#include <functional>
 
 class QNetworkReply;
 class QNetworkRequest;
@@ -12,28 +15,43 @@ class OrnApiRequest : public QObject
     Q_OBJECT
 
 public:
+    typedef std::function<void(const QJsonDocument &)> Callback;
+
     explicit OrnApiRequest(QObject *parent = nullptr);
     ~OrnApiRequest();
 
-    void run(const QNetworkRequest &request);
+    quint32 run(const QNetworkRequest &request, Callback callback = Callback());
+    inline bool running() const { return !mReplies.isEmpty(); }
+    inline bool running(quint32 id) const { return mReplies.contains(id); }
 
     inline static QUrl apiUrl(const QString &resource) { return QUrl(apiUrlPrefix + resource); }
 
     static QNetworkRequest networkRequest(const QUrl &url);
 
 public slots:
+    void cancel(quint32 id);
     void reset();
 
 signals:
     void jsonReady(const QJsonDocument &jsonDoc);
-
-protected slots:
-    void onReplyFinished();
+    // Emitted for each finished request whether it succeeded or not
+    void requestFinished(quint32 id);
 
 protected:
-    QNetworkReply *mNetworkReply;
+    typedef std::function<void(QNetworkReply *)> ReplyHandler;
+    quint32 track(QNetworkReply *reply, ReplyHandler handler);
 
 private:
+    quint32 mLastId;
+    // <request id, reply>
+    QHash<quint32, QNetworkReply *> mReplies;
+
+    static QNetworkReply *sharedGet(const QNetworkRequest &request);
+    static void release(QNetworkReply *reply);
+
+    // Running GET requests, <url and authorisation token, reply>
+    static QHash<QByteArray, QNetworkReply *> inFlight;
+
     static const QString apiUrlPrefix;
     static const QByteArray langName;
     static const QByteArray langValue;
@@ -46,7 +46,7 @@ OrnApplication::OrnApplication(QObject *parent)
     auto ornPm = OrnPm::instance();
     connect(ornPm, &OrnPm::repoModified, this, &OrnApplication::onRepoListChanged);
     connect(ornPm, &OrnPm::packageStatusChanged, this, &OrnApplication::onPackageStatusChanged);
-    connect(ornPm, &OrnPm::updatablePackagesChanged, this, &OrnApplication::onUpdatablePackagesChanged);
+    connect(ornPm, &OrnPm::updatablePackagesDiff, this, &OrnApplication::onUpdatablePackagesDiff);
 
     connect(ornPm, &OrnPm::packageVersions, this, &OrnApplication::onPackageVersions);
 
@@ -166,6 +166,11 @@ QString OrnApplication::category() const
 
 void OrnApplication::ornRequest()
 {
+    if (this->running())
+    {
+        qDebug() << "Request is already running";
+        return;
+    }
     auto url = OrnApiRequest::apiUrl(QStringLiteral("apps/%0").arg(mAppId));
     auto request = OrnApiRequest::networkRequest(url);
     this->run(request);
@@ -313,9 +318,12 @@ void OrnApplication::onPackageStatusChanged(const QString &packageName,
     }
 }
 
-void OrnApplication::onUpdatablePackagesChanged()
+void OrnApplication::onUpdatablePackagesDiff(const QStringList &added, const QStringList &removed,
+                                             const QStringList &changed)
 {
-    if (mPackageName.size())
+    if (mPackageName.size() &&
+        (added.contains(mPackageName) || removed.contains(mPackageName) ||
+         changed.contains(mPackageName)))
     {
         OrnPm::instance()->getPackageVersions(mPackageName);
     }
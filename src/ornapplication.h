@@ -102,7 +102,8 @@ private slots:
     void onJsonReady(const QJsonDocument &jsonDoc);
     void onRepoListChanged();
     void onPackageStatusChanged(const QString &packageName, const OrnPm::PackageStatus &status);
-    void onUpdatablePackagesChanged();
+    void onUpdatablePackagesDiff(const QStringList &added, const QStringList &removed,
+                                 const QStringList &changed);
     void onPackageVersions(const QString &packageName, const OrnPackageVersionList &versions);
 
 private:
@@ -72,7 +72,7 @@ void OrnBackup::backup(const QString &filePath)
         qCritical() << "Failed to create directory" << dir.absolutePath();
         emit this->backupError(DirectoryError);
     }
-    QtConcurrent::run(this, &OrnBackup::pBackup);
+    QtConcurrent::run(this, &OrnBackup::pBackup, OrnPm::instance()->d_ptr->state);
 }
 
 void OrnBackup::restore(const QString &filePath)
@@ -88,7 +88,7 @@ void OrnBackup::restore(const QString &filePath)
 
     mFilePath = filePath;
     auto watcher = new QFutureWatcher<void>();
-    connect(watcher, &QFutureWatcher<void>::finished, this, &OrnBackup::pRefreshRepos);
+    connect(watcher, &QFutureWatcher<void>::finished, this, &OrnBackup::pAddRepos);
     watcher->setFuture(QtConcurrent::run(this, &OrnBackup::pRestore));
 }
 
@@ -110,8 +110,8 @@ void OrnBackup::pSearchPackages()
     qDebug() << "Searching packages";
     this->setStatus(SearchingPackages);
 
-    // Delete future watcher and prepare variables
-    this->sender()->deleteLater();
+    disconnect(OrnPm::instance(), &OrnPm::refreshReposFinished,
+               this, &OrnBackup::pSearchPackages);
     mPackagesToInstall.clear();
 
     auto t = OrnPm::instance()->d_ptr->transaction();
@@ -181,7 +181,7 @@ void OrnBackup::pInstallPackages()
         connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(pFinishRestore()));
         qDebug().nospace() << "Calling " << t << "->" PK_METHOD_INSTALLPACKAGES "("
                            << PK_FLAG_NONE << ", " << ids << ")";
-        t->call(QStringLiteral(PK_METHOD_INSTALLPACKAGES), PK_FLAG_NONE, ids);
+        t->asyncCall(QStringLiteral(PK_METHOD_INSTALLPACKAGES), PK_FLAG_NONE, ids);
     }
 }
 
@@ -193,7 +193,7 @@ void OrnBackup::pFinishRestore()
     emit this->restored();
 }
 
-void OrnBackup::pBackup()
+void OrnBackup::pBackup(const QSharedPointer<const OrnPmState> &pmState)
 {
     qDebug() << "Starting backing up";
     this->setStatus(BackingUp);
@@ -203,7 +203,7 @@ void OrnBackup::pBackup()
     auto ornpm_p = OrnPm::instance()->d_ptr;
 
     auto prefix_size = OrnPm::repoNamePrefix.size();
-    for (auto it = ornpm_p->repos.cbegin(); it != ornpm_p->repos.cend(); ++it)
+    for (auto it = pmState->repos.cbegin(); it != pmState->repos.cend(); ++it)
     {
         auto author = it.key().mid(prefix_size);
         repos << author;
@@ -219,7 +219,7 @@ void OrnBackup::pBackup()
 
     qDebug() << "Backing up installed packages";
     QStringList installed;
-    for (const auto &p : ornpm_p->prepareInstalledPackages(QString()))
+    for (const auto &p : ornpm_p->prepareInstalledPackages(QString(), pmState))
     {
         installed << p.name;
     }
@@ -252,30 +252,56 @@ void OrnBackup::pRestore()
         client->mBookmarks.insert(b.toUInt());
     }
 
-    qDebug() << "Restoring repos";
-    this->setStatus(RestoringRepos);
-
     auto repos = file.value(BR_REPO_ALL).toStringList();
     auto disabled = file.value(BR_REPO_DISABLED).toStringList().toSet();
     mNamesToSearch = file.value(BR_INSTALLED).toStringList();
 
-    auto ornpm_p = OrnPm::instance()->d_ptr;
-    QString method(SSU_METHOD_ADDREPO);
-    QString repo_tmpl(REPO_URL_TMPL);
+    mRestoredRepos.clear();
     for (const auto &author : repos)
     {
-        auto alias = OrnPm::repoNamePrefix + author;
-        ornpm_p->ssuInterface->call(QDBus::Block, method, alias, repo_tmpl.arg(author));
-        ornpm_p->repos.insert(alias, !disabled.contains(author));
+        mRestoredRepos.insert(OrnPm::repoNamePrefix + author, !disabled.contains(author));
+    }
+}
+
+void OrnBackup::pAddRepos()
+{
+    // Delete future watcher
+    this->sender()->deleteLater();
+
+    qDebug() << "Restoring repos";
+    this->setStatus(RestoringRepos);
+
+    // Repos are added with asynchronous calls in the GUI thread
+    QList<QVariantList> calls;
+    QString repo_tmpl(REPO_URL_TMPL);
+    auto prefix_size = OrnPm::repoNamePrefix.size();
+    for (auto it = mRestoredRepos.cbegin(); it != mRestoredRepos.cend(); ++it)
+    {
+        calls << QVariantList{ it.key(), repo_tmpl.arg(it.key().mid(prefix_size)) };
     }
+    OrnPm::instance()->d_ptr->callSsuBatch(QStringLiteral(SSU_METHOD_ADDREPO), calls, [this](int failed)
+    {
+        qDebug() << "Restored" << mRestoredRepos.size() << "repos with" << failed << "errors";
+        this->pRefreshRepos();
+    });
 }
 
 void OrnBackup::pRefreshRepos()
 {
+    // The package manager state can be changed only in the GUI thread
+    auto ornpm_p = OrnPm::instance()->d_ptr;
+    auto pmState = ornpm_p->copyState();
+    for (auto it = mRestoredRepos.cbegin(); it != mRestoredRepos.cend(); ++it)
+    {
+        pmState->repos.insert(it.key(), it.value());
+    }
+    ornpm_p->publishState(pmState);
+    mRestoredRepos.clear();
+
+    // Let OrnPm decide which repos need refresh and how to refresh them
     qDebug() << "Refreshing repos";
     this->setStatus(RefreshingRepos);
-    auto t = OrnPm::instance()->d_ptr->transaction();
-    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(pSearchPackages()));
-    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_REFRESHCACHE "(false)";
-    t->asyncCall(QStringLiteral(PK_METHOD_REFRESHCACHE), false);
+    auto ornPm = OrnPm::instance();
+    connect(ornPm, &OrnPm::refreshReposFinished, this, &OrnBackup::pSearchPackages);
+    ornPm->refreshRepos();
 }
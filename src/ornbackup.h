@@ -4,6 +4,9 @@
 #include <QObject>
 #include <QHash>
 #include <QVariant>
+#include <QSharedPointer>
+
+struct OrnPmState;
 
 class OrnBackup : public QObject
 {
@@ -54,14 +57,17 @@ private slots:
 
 private:
     void setStatus(const Status &status);
-    void pBackup();
+    void pBackup(const QSharedPointer<const OrnPmState> &pmState);
     void pRestore();
+    void pAddRepos();
     void pRefreshRepos();
 
 private:
     Status mStatus;
     QString mFilePath;
     QStringList mNamesToSearch;
+    // Repos added by restore, <alias, enabled>
+    QHash<QString, bool> mRestoredRepos;
     // Name, version
     QHash<QString, QString> mInstalled;
     QMultiHash<QString, QString> mPackagesToInstall;
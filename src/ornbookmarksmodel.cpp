@@ -1,14 +1,30 @@
 #include "ornbookmarksmodel.h"
 #include "ornapplistitem.h"
+#include "ornapirequest.h"
 #include "ornclient.h"
 #include "orn.h"
 
 #include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QAbstractNetworkCache>
+#include <QNetworkRequest>
+#include <QTimer>
 
-OrnBookmarksModel::OrnBookmarksModel(QObject *parent) :
-    OrnAbstractAppsModel(false, parent)
+// Maximum number of simultaneous requests
+#define BOOKMARKS_REQUESTS_LIMIT    4
+// Arrived apps are inserted at most once per frame
+#define BOOKMARKS_INSERT_INTERVAL   16
+
+OrnBookmarksModel::OrnBookmarksModel(QObject *parent)
+    : OrnAbstractAppsModel(false, parent)
+    , mInserted(0)
+    , mInsertTimer(new QTimer(this))
 {
+    mInsertTimer->setSingleShot(true);
+    mInsertTimer->setInterval(BOOKMARKS_INSERT_INTERVAL);
+    connect(mInsertTimer, &QTimer::timeout, this, &OrnBookmarksModel::insertArrived);
+    connect(mApiRequest, &OrnApiRequest::requestFinished,
+            this, &OrnBookmarksModel::onRequestFinished);
+    connect(this, &OrnBookmarksModel::modelReset, this, &OrnBookmarksModel::clearLoader);
     connect(OrnClient::instance(), &OrnClient::bookmarkChanged,
             this, &OrnBookmarksModel::onBookmarkChanged);
 }
@@ -32,42 +48,169 @@ void OrnBookmarksModel::onBookmarkChanged(quint32 appId, bool bookmarked)
                 mData.removeAt(i);
                 this->endRemoveRows();
                 delete app;
-                return;
+                break;
+            }
+        }
+
+        // Forget the app so it is loaded again if it is bookmarked again
+        auto pos = mOrder.indexOf(appId);
+        if (pos != -1)
+        {
+            mOrder.removeAt(pos);
+            if (pos < mInserted)
+            {
+                --mInserted;
             }
         }
+        mQueue.removeAll(appId);
+        mArrived.remove(appId);
+        mFailed.remove(appId);
+
+        // Free the request slot, cancelled requests do not emit requestFinished()
+        for (auto it = mRequests.begin(); it != mRequests.end(); ++it)
+        {
+            if (it.value() == appId)
+            {
+                mApiRequest->cancel(it.key());
+                mRequests.erase(it);
+                break;
+            }
+        }
+        // The removed app could hold back the insertion of the following ones
+        this->startRequests();
     }
 }
 
 void OrnBookmarksModel::addApp(const quint32 &appId)
 {
+    // Arrived apps are keyed by their ids so each app is loaded only once
+    if (mOrder.contains(appId))
+    {
+        return;
+    }
     qDebug() << "Adding app" << appId << "to bookmarks model";
-    auto url = OrnApiRequest::apiUrl(QStringLiteral("apps/%1/compact").arg(appId));
-    auto request = OrnApiRequest::networkRequest(url);
-    auto reply = Orn::networkAccessManager()->get(request);
-    connect(reply, &QNetworkReply::finished, [this, reply]()
+    mOrder << appId;
+    mQueue << appId;
+    this->startRequests();
+}
+
+/*!
+    Takes apps from the queue. Cached apps are used at once, the others
+    are requested keeping the number of running requests limited.
+ */
+void OrnBookmarksModel::startRequests()
+{
+    while (!mQueue.isEmpty() && mRequests.size() < BOOKMARKS_REQUESTS_LIMIT)
     {
-        if (reply->error() == QNetworkReply::NoError)
+        auto appId = mQueue.takeFirst();
+        if (this->takeCached(appId))
         {
-            QJsonParseError error;
-            auto jsonDoc = QJsonDocument::fromJson(reply->readAll(), &error);
-            if (error.error == QJsonParseError::NoError)
-            {
-                QJsonArray arr;
-                arr.append(jsonDoc.object());
-                emit mApiRequest->jsonReady(QJsonDocument(arr));
-            }
-            else
+            continue;
+        }
+        auto url = OrnApiRequest::apiUrl(QStringLiteral("apps/%1/compact").arg(appId));
+        auto id = mApiRequest->run(OrnApiRequest::networkRequest(url),
+                                   [this, appId](const QJsonDocument &jsonDoc)
+        {
+            if (mOrder.contains(appId))
             {
-                qCritical() << "Could not parse reply:" << error.errorString();
+                mArrived.insert(appId, jsonDoc.object());
             }
+        });
+        mRequests.insert(id, appId);
+    }
+    if (!mInsertTimer->isActive())
+    {
+        mInsertTimer->start();
+    }
+}
+
+void OrnBookmarksModel::onRequestFinished(quint32 id)
+{
+    auto it = mRequests.find(id);
+    if (it == mRequests.end())
+    {
+        return;
+    }
+    auto appId = it.value();
+    mRequests.erase(it);
+    // The app could be removed from bookmarks while it was loading
+    if (!mArrived.contains(appId) && mOrder.contains(appId))
+    {
+        qWarning() << "Could not fetch bookmarked app" << appId;
+        mFailed.insert(appId);
+    }
+    this->startRequests();
+}
+
+/*!
+    Returns true if a fresh reply for the \a appId is in the API cache.
+ */
+bool OrnBookmarksModel::takeCached(const quint32 &appId)
+{
+    auto cache = Orn::networkAccessManager()->cache();
+    if (!cache)
+    {
+        return false;
+    }
+    auto url = OrnApiRequest::apiUrl(QStringLiteral("apps/%1/compact").arg(appId));
+    auto metaData = cache->metaData(url);
+    if (!metaData.isValid() || metaData.expirationDate() <= QDateTime::currentDateTimeUtc())
+    {
+        return false;
+    }
+    auto device = cache->data(url);
+    if (!device)
+    {
+        return false;
+    }
+    auto jsonDoc = QJsonDocument::fromJson(device->readAll());
+    delete device;
+    if (!jsonDoc.isObject())
+    {
+        return false;
+    }
+    mArrived.insert(appId, jsonDoc.object());
+    return true;
+}
+
+/*!
+    Inserts the arrived apps which follow the already inserted ones with
+    a single row insertion, so the order of bookmarks is kept.
+ */
+void OrnBookmarksModel::insertArrived()
+{
+    auto client = OrnClient::instance();
+    OrnItemList list;
+    auto size = mOrder.size();
+    for (; mInserted < size; ++mInserted)
+    {
+        auto appId = mOrder[mInserted];
+        if (mFailed.remove(appId))
+        {
+            continue;
+        }
+        auto it = mArrived.find(appId);
+        if (it == mArrived.end())
+        {
+            break;
         }
-        else
+        // The bookmark could be removed while the app was loading
+        if (client->hasBookmark(appId))
         {
-            qDebug() << "Network request error" << reply->error()
-                     << "-" << reply->errorString();
+            list << new OrnAppListItem(it.value());
         }
-        reply->deleteLater();
-    });
+        mArrived.erase(it);
+    }
+
+    if (!list.isEmpty())
+    {
+        auto row = mData.size();
+        this->beginInsertRows(QModelIndex(), row, row + list.size() - 1);
+        mData.append(list);
+        qDebug() << list.size() << "bookmarked app(s) have been added to the model";
+        this->endInsertRows();
+        emit this->replyProcessed();
+    }
 }
 
 void OrnBookmarksModel::fetchMore(const QModelIndex &parent)
@@ -77,8 +220,25 @@ void OrnBookmarksModel::fetchMore(const QModelIndex &parent)
         return;
     }
 
-    for (const auto &appid : OrnClient::instance()->bookmarks())
+    mCanFetchMore = false;
+    this->clearLoader();
+    for (const auto &appId : OrnClient::instance()->bookmarks())
     {
-        this->addApp(appid);
+        this->addApp(appId);
     }
 }
+
+/*!
+    Cancels the running requests and forgets the apps which are not inserted yet.
+ */
+void OrnBookmarksModel::clearLoader()
+{
+    mInsertTimer->stop();
+    mApiRequest->reset();
+    mRequests.clear();
+    mArrived.clear();
+    mFailed.clear();
+    mInserted = 0;
+    mOrder.clear();
+    mQueue.clear();
+}
@@ -3,6 +3,10 @@
 
 #include "ornabstractappsmodel.h"
 
+#include <QSet>
+
+class QTimer;
+
 class OrnBookmarksModel : public OrnAbstractAppsModel
 {
     Q_OBJECT
@@ -13,6 +17,24 @@ public:
 private slots:
     void onBookmarkChanged(quint32 appId, bool bookmarked);
     void addApp(const quint32 &appId);
+    void startRequests();
+    void onRequestFinished(quint32 id);
+    void insertArrived();
+    void clearLoader();
+
+private:
+    bool takeCached(const quint32 &appId);
+
+    // Bookmarked apps in the order they should appear in the model
+    QList<quint32> mOrder;
+    // Index of the first app in mOrder which is not in the model yet
+    int mInserted;
+    QList<quint32> mQueue;
+    // <request id, app id>
+    QHash<quint32, quint32> mRequests;
+    QHash<quint32, QJsonObject> mArrived;
+    QSet<quint32> mFailed;
+    QTimer *mInsertTimer;
 
     // QAbstractItemModel interface
 public:
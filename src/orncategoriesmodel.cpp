@@ -67,6 +67,29 @@ void OrnCategoriesModel::onJsonReady(const QJsonDocument &jsonDoc)
     {
         list << OrnCategoryListItem::parse(category.toObject());
     }
+
+    // Categories are a flattened tree so a changed cached reply resets the model
+    if (mRevalidating)
+    {
+        mRevalidating = false;
+        auto changed = categoriesArray != mCachedPage;
+        mCachedPage = QJsonArray();
+        if (!changed)
+        {
+            qDeleteAll(list);
+            emit this->replyProcessed();
+            return;
+        }
+        qDebug() << "Replacing cached categories";
+        this->beginResetModel();
+        auto d = mData;
+        mData = list;
+        this->endResetModel();
+        qDeleteAll(d);
+        emit this->replyProcessed();
+        return;
+    }
+
     this->beginInsertRows(QModelIndex(), 0, list.size() - 1);
     mData = list;
     qDebug() << list.size() << "items have been added to the model";
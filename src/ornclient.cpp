@@ -6,6 +6,7 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QNetworkCookie>
+#include <QAbstractNetworkCache>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -42,18 +43,16 @@ OrnClient::OrnClient(QObject *parent)
         qDebug() << "Checking authorisation status";
         auto request = this->authorisedRequest();
         request.setUrl(OrnClient::apiUrl(QStringLiteral("session")));
-        mNetworkReply = Orn::networkAccessManager()->get(request);
-        connect(mNetworkReply, &QNetworkReply::finished, [=]()
+        this->track(Orn::networkAccessManager()->get(request), [this](QNetworkReply *reply)
         {
 #ifdef QT_DEBUG
-            if (this->processReply().object().contains(QStringLiteral("token")))
+            if (this->processReply(reply).object().contains(QStringLiteral("token")))
             {
                 qDebug() << "Client is authorised";
             }
 #else
-            this->processReply();
+            this->processReply(reply);
 #endif
-            this->reset();
         });
     }
 
@@ -75,6 +74,12 @@ OrnClient::OrnClient(QObject *parent)
         }
     }
 
+    // Cached replies could contain data of another user
+    connect(this, &OrnClient::authorisedChanged, []()
+    {
+        Orn::networkAccessManager()->cache()->clear();
+    });
+
     // A workaround as qml does not call a destructor
     connect(qApp, &QGuiApplication::aboutToQuit, this, &OrnClient::deleteLater);
 
@@ -185,8 +190,8 @@ void OrnClient::login(const QString &username, const QString &password)
     jsonObject.insert(QStringLiteral("password"), password);
     QJsonDocument jsonDoc(jsonObject);
 
-    mNetworkReply = Orn::networkAccessManager()->post(request, jsonDoc.toJson());
-    connect(mNetworkReply, &QNetworkReply::finished, this, &OrnClient::onLoggedIn);
+    this->track(Orn::networkAccessManager()->post(request, jsonDoc.toJson()),
+                [this](QNetworkReply *reply) { this->onLoggedIn(reply); });
 }
 
 void OrnClient::logout()
@@ -213,18 +218,17 @@ void OrnClient::comment(const quint32 &appId, const QString &body, const quint32
         commentObject.insert(QStringLiteral("pid"), QString::number(parentId));
     }
 
-    mNetworkReply = Orn::networkAccessManager()->post(
+    auto reply = Orn::networkAccessManager()->post(
                 request, QJsonDocument(commentObject).toJson());
-    connect(mNetworkReply, &QNetworkReply::finished, [this, appId]()
+    this->track(reply, [this, appId](QNetworkReply *reply)
     {
-        auto jsonDoc = this->processReply();
+        auto jsonDoc = this->processReply(reply);
         if (jsonDoc.isObject())
         {
             auto cid = Orn::toUint(jsonDoc.object()[QStringLiteral("cid")]);
             emit this->commentAdded(appId, cid);
             qDebug() << "Comment" << cid << "added for app" << appId;
         }
-        this->reset();
     });
 }
 
@@ -237,9 +241,9 @@ void OrnClient::editComment(const quint32 &commentId, const QString &body)
     QJsonObject commentObject;
     OrnClient::prepareComment(commentObject, body);
 
-    mNetworkReply = Orn::networkAccessManager()->put(
+    auto reply = Orn::networkAccessManager()->put(
                 request, QJsonDocument(commentObject).toJson());
-    connect(mNetworkReply, &QNetworkReply::finished, this, &OrnClient::onCommentEdited);
+    this->track(reply, [this](QNetworkReply *reply) { this->onCommentEdited(reply); });
 }
 
 void OrnClient::vote(const quint32 &appId, const quint32 &value)
@@ -261,7 +265,7 @@ void OrnClient::vote(const quint32 &appId, const quint32 &value)
 
     qDebug() << "Posting user vote" << value << "for app" << appId;
     auto reply = Orn::networkAccessManager()->post(request, QJsonDocument(voteObject).toJson());
-    connect(reply, &QNetworkReply::finished, [this, reply, appId, value]()
+    this->track(reply, [this, appId, value](QNetworkReply *reply)
     {
         if (reply->error() == QNetworkReply::NoError)
         {
@@ -277,7 +281,6 @@ void OrnClient::vote(const quint32 &appId, const quint32 &value)
         {
             qWarning() << "Posting user vote" << value << "for app" << appId << "failed!";
         }
-        reply->deleteLater();
     });
 }
 
@@ -308,15 +311,15 @@ void OrnClient::setCookieTimer()
     }
 }
 
-void OrnClient::onLoggedIn()
+void OrnClient::onLoggedIn(QNetworkReply *reply)
 {
-    auto jsonDoc = this->processReply();
+    auto jsonDoc = this->processReply(reply);
     if (jsonDoc.isEmpty())
     {
         emit this->authorisationError();
         return;
     }
-    auto cookieVariant = mNetworkReply->header(QNetworkRequest::SetCookieHeader);
+    auto cookieVariant = reply->header(QNetworkRequest::SetCookieHeader);
     if (cookieVariant.isValid() && jsonDoc.isObject())
     {
         auto jsonObject = jsonDoc.object();
@@ -351,19 +354,17 @@ void OrnClient::onLoggedIn()
         emit this->authorisedChanged();
         this->setCookieTimer();
     }
-    this->reset();
 }
 
-void OrnClient::onCommentEdited()
+void OrnClient::onCommentEdited(QNetworkReply *reply)
 {
-    auto jsonDoc = this->processReply();
+    auto jsonDoc = this->processReply(reply);
     if (jsonDoc.isArray())
     {
         auto cid = Orn::toUint(jsonDoc.array().first());
         emit this->commentEdited(cid);
         qDebug() << "Comment edited:" << cid;
     }
-    this->reset();
 }
 
 QNetworkRequest OrnClient::authorisedRequest()
@@ -376,13 +377,13 @@ QNetworkRequest OrnClient::authorisedRequest()
     return request;
 }
 
-QJsonDocument OrnClient::processReply()
+QJsonDocument OrnClient::processReply(QNetworkReply *reply)
 {
-    auto networkError = mNetworkReply->error();
+    auto networkError = reply->error();
     if (networkError != QNetworkReply::NoError)
     {
-        qDebug() << "Network request error" << mNetworkReply->error()
-                 << "-" << mNetworkReply->errorString();
+        qDebug() << "Network request error" << reply->error()
+                 << "-" << reply->errorString();
         if (this->authorised())
         {
             emit this->cookieIsValidChanged();
@@ -391,7 +392,7 @@ QJsonDocument OrnClient::processReply()
     }
 
     QJsonParseError error;
-    auto jsonDoc = QJsonDocument::fromJson(mNetworkReply->readAll(), &error);
+    auto jsonDoc = QJsonDocument::fromJson(reply->readAll(), &error);
     if (error.error != QJsonParseError::NoError)
     {
         qCritical() << "Could not parse reply:" << error.errorString();
@@ -66,14 +66,14 @@ signals:
 
 private slots:
     void setCookieTimer();
-    void onLoggedIn();
-    void onCommentEdited();
 
 private:
     explicit OrnClient(QObject *parent = nullptr);
     ~OrnClient();
+    void onLoggedIn(QNetworkReply *reply);
+    void onCommentEdited(QNetworkReply *reply);
     QNetworkRequest authorisedRequest();
-    QJsonDocument processReply();
+    QJsonDocument processReply(QNetworkReply *reply);
     static void prepareComment(QJsonObject &object, const QString &body);
 
 private:
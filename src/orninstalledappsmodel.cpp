@@ -15,8 +15,8 @@ OrnInstalledAppsModel::OrnInstalledAppsModel(QObject *parent)
             this, &OrnInstalledAppsModel::onPackageInstalled);
     connect(ornPm, &OrnPm::packageRemoved,
             this, &OrnInstalledAppsModel::onPackageRemoved);
-    connect(ornPm, &OrnPm::updatablePackagesChanged,
-            this , &OrnInstalledAppsModel::onUpdatablePackagesChanged);
+    connect(ornPm, &OrnPm::updatablePackagesDiff,
+            this, &OrnInstalledAppsModel::onUpdatablePackagesDiff);
     this->reset();
 }
 
@@ -26,6 +26,7 @@ void OrnInstalledAppsModel::reset()
     this->beginResetModel();
     mResetting = true;
     mData.clear();
+    mRows.clear();
     OrnPm::instance()->getInstalledPackages();
 }
 
@@ -44,6 +45,7 @@ void OrnInstalledAppsModel::onInstalledPackages(const OrnInstalledPackageList &p
     {
         return;
     }
+    mRows.clear();
 
     auto count = mData.size();
     QModelIndex parentIndex;
@@ -102,27 +104,33 @@ void OrnInstalledAppsModel::onPackageInstalled(const QString &packageName)
 
 void OrnInstalledAppsModel::onPackageRemoved(const QString &packageName)
 {
-    auto size = mData.size();
-    for (OrnInstalledPackageList::size_type i = 0; i < size; ++i)
+    auto i = this->rowOf(packageName);
+    if (i != -1)
     {
-        if (mData[i].name == packageName)
-        {
-            qDebug() << "Removing model item" << packageName;
-            this->beginRemoveRows(QModelIndex(), i, i);
-            mData.removeAt(i);
-            this->endRemoveRows();
-            return;
-        }
+        qDebug() << "Removing model item" << packageName;
+        this->beginRemoveRows(QModelIndex(), i, i);
+        mData.removeAt(i);
+        mRows.clear();
+        this->endRemoveRows();
     }
 }
 
-void OrnInstalledAppsModel::onUpdatablePackagesChanged()
+/*!
+    Updates only the rows of packages which updates have changed.
+ */
+void OrnInstalledAppsModel::onUpdatablePackagesDiff(const QStringList &added,
+                                                    const QStringList &removed,
+                                                    const QStringList &changed)
 {
     auto ornPm = OrnPm::instance();
     QVector<int> roles = { SortRole, UpdateAvailableRole };
-    auto count = mData.size();
-    for (OrnInstalledPackageList::size_type i = 0; i < count; ++i)
+    for (const auto &name : added + removed + changed)
     {
+        auto i = this->rowOf(name);
+        if (i == -1)
+        {
+            continue;
+        }
         auto &package = mData[i];
         bool ua = ornPm->packageStatus(package.name) ==
                 OrnPm::PackageUpdateAvailable;
@@ -135,6 +143,22 @@ void OrnInstalledAppsModel::onUpdatablePackagesChanged()
     }
 }
 
+/*!
+    Returns the row of the package with the \a packageName or -1 if there is no such package.
+ */
+int OrnInstalledAppsModel::rowOf(const QString &packageName)
+{
+    if (mRows.isEmpty() && !mData.isEmpty())
+    {
+        mRows.reserve(mData.size());
+        for (int i = 0; i < mData.size(); ++i)
+        {
+            mRows.insert(mData[i].name, i);
+        }
+    }
+    return mRows.value(packageName, -1);
+}
+
 int OrnInstalledAppsModel::rowCount(const QModelIndex &parent) const
 {
     return !parent.isValid() ? mData.size() : 0;
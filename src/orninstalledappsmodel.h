@@ -33,11 +33,16 @@ private slots:
     void onInstalledPackages(const OrnInstalledPackageList &packages);
     void onPackageInstalled(const QString &packageName);
     void onPackageRemoved(const QString &packageName);
-    void onUpdatablePackagesChanged();
+    void onUpdatablePackagesDiff(const QStringList &added, const QStringList &removed,
+                                 const QStringList &changed);
 
 private:
+    int rowOf(const QString &packageName);
+
     bool mResetting;
     OrnInstalledPackageList mData;
+    // <package name, row>, it is rebuilt when rows are inserted or removed
+    QHash<QString, int> mRows;
 
     // QAbstractItemModel interface
 public:
@@ -0,0 +1,283 @@
+#include "orninstalledtable.h"
+#include "orn.h"
+
+#include <QDataStream>
+
+#include <algorithm>
+
+// Average length of name, evr and arch strings with terminating zeros
+#define ENTRY_BYTES 48
+
+OrnInstalledTable::OrnInstalledTable()
+    : mUnused(0)
+{}
+
+int OrnInstalledTable::indexOf(const QString &name) const
+{
+    auto i = this->lowerBound(name);
+    if (i < mEntries.size() &&
+        QString::compare(name, QLatin1String(this->string(mEntries[i].name))) == 0)
+    {
+        return i;
+    }
+    return -1;
+}
+
+QString OrnInstalledTable::packageId(const QString &name) const
+{
+    auto i = this->indexOf(name);
+    return i == -1 ? QString() : this->packageId(i);
+}
+
+QString OrnInstalledTable::name(int i) const
+{
+    return QString::fromUtf8(this->string(mEntries[i].name));
+}
+
+QString OrnInstalledTable::packageId(int i) const
+{
+    const auto &e = mEntries[i];
+    QChar sep(';');
+    QString id(QString::fromUtf8(this->string(e.name)));
+    id.append(sep).append(QString::fromUtf8(this->string(e.evr)))
+      .append(sep).append(QLatin1String(this->string(e.arch)))
+      .append(QLatin1String(";installed"));
+    return id;
+}
+
+void OrnInstalledTable::reserve(int size)
+{
+    mEntries.reserve(size);
+    mStrings.reserve(size * ENTRY_BYTES);
+}
+
+void OrnInstalledTable::append(const char *name, const char *evr, const char *arch)
+{
+    mEntries.append(Entry{ this->addString(name), this->addString(evr), this->addArch(arch) });
+}
+
+/*!
+    Sorts the entries by name. If there are several entries with the same name
+    then the last appended is kept.
+ */
+void OrnInstalledTable::sort()
+{
+    std::stable_sort(mEntries.begin(), mEntries.end(), [this](const Entry &a, const Entry &b)
+    {
+        return qstrcmp(this->string(a.name), this->string(b.name)) < 0;
+    });
+
+    auto size = mEntries.size();
+    int j = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        if (i + 1 < size &&
+            qstrcmp(this->string(mEntries[i].name), this->string(mEntries[i + 1].name)) == 0)
+        {
+            continue;
+        }
+        mEntries[j++] = mEntries[i];
+    }
+    mEntries.resize(j);
+    mEntries.squeeze();
+    mStrings.squeeze();
+}
+
+void OrnInstalledTable::insert(const QString &packageId)
+{
+    auto name = Orn::packageName(packageId);
+    auto evr  = Orn::packageVersion(packageId).toUtf8();
+    auto arch = Orn::packageArch(packageId).toUtf8();
+
+    auto i = this->lowerBound(name);
+    if (i < mEntries.size() &&
+        QString::compare(name, QLatin1String(this->string(mEntries[i].name))) == 0)
+    {
+        auto &e = mEntries[i];
+        if (qstrcmp(this->string(e.evr), evr.constData()) != 0)
+        {
+            mUnused += qstrlen(this->string(e.evr)) + 1;
+            e.evr = this->addString(evr.constData());
+        }
+        e.arch = this->addArch(arch.constData());
+    }
+    else
+    {
+        mEntries.insert(i, Entry{ this->addString(name.toUtf8().constData()),
+                                  this->addString(evr.constData()),
+                                  this->addArch(arch.constData()) });
+    }
+    this->compact();
+}
+
+bool OrnInstalledTable::remove(const QString &name)
+{
+    auto i = this->indexOf(name);
+    if (i == -1)
+    {
+        return false;
+    }
+    const auto &e = mEntries[i];
+    mUnused += qstrlen(this->string(e.name)) + qstrlen(this->string(e.evr)) + 2;
+    mEntries.remove(i);
+    this->compact();
+    return true;
+}
+
+/*!
+    Rebuilds the strings buffer if more than a half of it is not used anymore.
+ */
+void OrnInstalledTable::compact()
+{
+    if (!mUnused || mUnused < quint32(mStrings.size()) / 2)
+    {
+        return;
+    }
+    OrnInstalledTable table;
+    table.reserve(mEntries.size());
+    for (const auto &e : mEntries)
+    {
+        table.append(this->string(e.name), this->string(e.evr), this->string(e.arch));
+    }
+    table.mStrings.squeeze();
+    *this = table;
+}
+
+/*!
+    Returns a table with only the packages which \a names are in the set.
+ */
+OrnInstalledTable OrnInstalledTable::filtered(const QSet<QString> &names) const
+{
+    OrnInstalledTable table;
+    for (const auto &e : mEntries)
+    {
+        auto name = this->string(e.name);
+        if (names.contains(QString::fromUtf8(name)))
+        {
+            // The entries are already sorted so the result does not need sorting
+            table.append(name, this->string(e.evr), this->string(e.arch));
+        }
+    }
+    return table;
+}
+
+/*!
+    Returns names of the packages that were added, removed or
+    changed their versions or archs in the \a other table.
+ */
+QStringList OrnInstalledTable::diff(const OrnInstalledTable &other) const
+{
+    QStringList changed;
+    auto size = mEntries.size();
+    auto otherSize = other.mEntries.size();
+    int i = 0;
+    int j = 0;
+    while (i < size || j < otherSize)
+    {
+        int c = i == size ? 1 : j == otherSize ? -1 :
+                qstrcmp(this->string(mEntries[i].name), other.string(other.mEntries[j].name));
+        if (c < 0)
+        {
+            changed << this->name(i++);
+        }
+        else if (c > 0)
+        {
+            changed << other.name(j++);
+        }
+        else
+        {
+            const auto &e = mEntries[i];
+            const auto &o = other.mEntries[j];
+            if (qstrcmp(this->string(e.evr), other.string(o.evr)) != 0 ||
+                qstrcmp(this->string(e.arch), other.string(o.arch)) != 0)
+            {
+                changed << this->name(i);
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return changed;
+}
+
+quint32 OrnInstalledTable::addString(const char *str)
+{
+    quint32 offset = mStrings.size();
+    mStrings.append(str, qstrlen(str) + 1);
+    return offset;
+}
+
+quint32 OrnInstalledTable::addArch(const char *arch)
+{
+    for (const auto &offset : mArchs)
+    {
+        if (qstrcmp(this->string(offset), arch) == 0)
+        {
+            return offset;
+        }
+    }
+    auto offset = this->addString(arch);
+    mArchs.append(offset);
+    return offset;
+}
+
+int OrnInstalledTable::lowerBound(const QString &name) const
+{
+    auto it = std::lower_bound(mEntries.cbegin(), mEntries.cend(), name,
+                               [this](const Entry &e, const QString &value)
+    {
+        return QString::compare(QLatin1String(this->string(e.name)), value) < 0;
+    });
+    return it - mEntries.cbegin();
+}
+
+QDataStream &operator<<(QDataStream &stream, const OrnInstalledTable &table)
+{
+    stream << table.mStrings << quint32(table.mEntries.size());
+    for (const auto &e : table.mEntries)
+    {
+        stream << e.name << e.evr << e.arch;
+    }
+    return stream << table.mArchs;
+}
+
+QDataStream &operator>>(QDataStream &stream, OrnInstalledTable &table)
+{
+    quint32 size = 0;
+    stream >> table.mStrings >> size;
+    table.mEntries.clear();
+    table.mEntries.reserve(size);
+    table.mUnused = 0;
+    quint32 bytes = table.mStrings.size();
+    // The offsets are checked below, the last string must be terminated too
+    if (bytes && table.mStrings.at(bytes - 1) != '\0')
+    {
+        stream.setStatus(QDataStream::ReadCorruptData);
+    }
+    for (quint32 i = 0; i < size && stream.status() == QDataStream::Ok; ++i)
+    {
+        OrnInstalledTable::Entry e;
+        stream >> e.name >> e.evr >> e.arch;
+        // Do not trust offsets from a damaged file
+        if (e.name >= bytes || e.evr >= bytes || e.arch >= bytes)
+        {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        table.mEntries.append(e);
+    }
+    stream >> table.mArchs;
+    for (const auto &offset : table.mArchs)
+    {
+        if (offset >= bytes)
+        {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+    }
+    if (stream.status() != QDataStream::Ok)
+    {
+        table = OrnInstalledTable();
+    }
+    return stream;
+}
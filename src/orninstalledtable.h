@@ -0,0 +1,75 @@
+#ifndef ORNINSTALLEDTABLE_H
+#define ORNINSTALLEDTABLE_H
+
+
+#include <QByteArray>
+#include <QVector>
+#include <QStringList>
+#include <QSet>
+
+class QDataStream;
+
+/*!
+    A compact table of installed packages sorted by name.
+
+    All the strings are stored in a single buffer and the table entries keep
+    only their offsets, so the table of thousands of packages needs just a few
+    allocations. Package IDs are composed on demand. Package names are expected
+    to be ASCII as it is required by rpm.
+ */
+class OrnInstalledTable
+{
+    friend QDataStream &operator<<(QDataStream &stream, const OrnInstalledTable &table);
+    friend QDataStream &operator>>(QDataStream &stream, OrnInstalledTable &table);
+
+public:
+    OrnInstalledTable();
+
+    inline int size() const { return mEntries.size(); }
+    inline bool isEmpty() const { return mEntries.isEmpty(); }
+
+    int indexOf(const QString &name) const;
+    inline bool contains(const QString &name) const { return this->indexOf(name) != -1; }
+    QString packageId(const QString &name) const;
+
+    // Accessors by an entry index in range [0, size())
+    QString name(int i) const;
+    QString packageId(int i) const;
+
+    void reserve(int size);
+    // Appends a package without sorting, call sort() after appending all the packages
+    void append(const char *name, const char *evr, const char *arch);
+    void sort();
+    void insert(const QString &packageId);
+    bool remove(const QString &name);
+
+    QStringList diff(const OrnInstalledTable &other) const;
+    OrnInstalledTable filtered(const QSet<QString> &names) const;
+
+private:
+    struct Entry
+    {
+        quint32 name;
+        quint32 evr;
+        quint32 arch;
+    };
+
+    inline const char *string(quint32 offset) const { return mStrings.constData() + offset; }
+    quint32 addString(const char *str);
+    quint32 addArch(const char *arch);
+    int lowerBound(const QString &name) const;
+    void compact();
+
+    // Zero terminated utf8 strings
+    QByteArray mStrings;
+    QVector<Entry> mEntries;
+    // There are only a few archs so they are stored once
+    QVector<quint32> mArchs;
+    // Bytes of the strings which are not referenced anymore
+    quint32 mUnused;
+};
+
+QDataStream &operator<<(QDataStream &stream, const OrnInstalledTable &table);
+QDataStream &operator>>(QDataStream &stream, OrnInstalledTable &table);
+
+#endif // ORNINSTALLEDTABLE_H
@@ -1,32 +1,175 @@
 #include "ornpackageversion.h"
 
-#include <QRegularExpression>
 
+static inline bool isDigit(ushort c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool isAlpha(ushort c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
 
-QVariantList splitVersion(const QString &version)
+/*!
+    Compares two version segments the same way rpmvercmp() does.
+    Returns a negative value, zero or a positive value if \a a is
+    lesser than, equal to or greater than \a b respectively.
+ */
+static int rpmvercmp(const QChar *a, const QChar *aend, const QChar *b, const QChar *bend)
 {
-    QVariantList parts;
-    static QRegularExpression sep_re(QStringLiteral("[.+~-]"));
-    bool ok;
-    for (const QString &s : version.split(sep_re))
+    while (a != aend || b != bend)
+    {
+        // Skip separators
+        while (a != aend && !isDigit(a->unicode()) && !isAlpha(a->unicode()) &&
+               a->unicode() != '~' && a->unicode() != '^')
+        {
+            ++a;
+        }
+        while (b != bend && !isDigit(b->unicode()) && !isAlpha(b->unicode()) &&
+               b->unicode() != '~' && b->unicode() != '^')
+        {
+            ++b;
+        }
+
+        // A tilde sorts before everything else
+        auto ac = a != aend ? a->unicode() : 0;
+        auto bc = b != bend ? b->unicode() : 0;
+        if (ac == '~' || bc == '~')
+        {
+            if (ac != '~')
+            {
+                return 1;
+            }
+            if (bc != '~')
+            {
+                return -1;
+            }
+            ++a;
+            ++b;
+            continue;
+        }
+
+        // A caret sorts after the end but before everything else
+        if (ac == '^' || bc == '^')
+        {
+            if (!ac)
+            {
+                return -1;
+            }
+            if (!bc)
+            {
+                return 1;
+            }
+            if (ac != '^')
+            {
+                return 1;
+            }
+            if (bc != '^')
+            {
+                return -1;
+            }
+            ++a;
+            ++b;
+            continue;
+        }
+
+        if (!ac || !bc)
+        {
+            break;
+        }
+
+        // Take the segments of the same type
+        auto a2 = a;
+        auto b2 = b;
+        bool isNum = isDigit(ac);
+        if (isNum)
+        {
+            while (a2 != aend && isDigit(a2->unicode()))
+            {
+                ++a2;
+            }
+            while (b2 != bend && isDigit(b2->unicode()))
+            {
+                ++b2;
+            }
+        }
+        else
+        {
+            while (a2 != aend && isAlpha(a2->unicode()))
+            {
+                ++a2;
+            }
+            while (b2 != bend && isAlpha(b2->unicode()))
+            {
+                ++b2;
+            }
+        }
+
+        // Segments of different types, a numeric one is newer
+        if (b == b2)
+        {
+            return isNum ? 1 : -1;
+        }
+
+        if (isNum)
+        {
+            // Skip leading zeros, then the longer number is greater
+            while (a != a2 && a->unicode() == '0')
+            {
+                ++a;
+            }
+            while (b != b2 && b->unicode() == '0')
+            {
+                ++b;
+            }
+            auto diff = (a2 - a) - (b2 - b);
+            if (diff)
+            {
+                return diff > 0 ? 1 : -1;
+            }
+        }
+
+        for (; a != a2 && b != b2; ++a, ++b)
+        {
+            if (*a != *b)
+            {
+                return a->unicode() < b->unicode() ? -1 : 1;
+            }
+        }
+        if (a != a2)
+        {
+            return 1;
+        }
+        if (b != b2)
+        {
+            return -1;
+        }
+    }
+
+    if (a == aend && b == bend)
     {
-        auto v = s.toInt(&ok);
-        parts << (ok ? QVariant(v) : QVariant(s));
+        return 0;
     }
-    return parts;
+    return a != aend ? 1 : -1;
 }
 
 OrnPackageVersion::OrnPackageVersion()
     : downloadSize(0)
     , installSize(0)
+    , epoch(0)
+    , versionBegin(0)
+    , versionEnd(0)
+    , releaseBegin(-1)
 {}
 
 OrnPackageVersion::OrnPackageVersion(const QString &version)
     : downloadSize(0)
     , installSize(0)
     , version(version)
-    , versionParts(splitVersion(version))
-{}
+{
+    this->parseVersion();
+}
 
 OrnPackageVersion::OrnPackageVersion(const quint64 &dsize, const quint64 &isize,
                                      const QString &version, QString arch, QString alias)
@@ -35,8 +178,46 @@ OrnPackageVersion::OrnPackageVersion(const quint64 &dsize, const quint64 &isize,
     , version(version)
     , arch(std::move(arch))
     , repoAlias(std::move(alias))
-    , versionParts(splitVersion(version))
-{}
+{
+    this->parseVersion();
+}
+
+/*!
+    Finds the parts of the version string once so that comparing
+    does not need to split it.
+ */
+void OrnPackageVersion::parseVersion()
+{
+    epoch = 0;
+    versionBegin = 0;
+    versionEnd = version.size();
+    releaseBegin = -1;
+
+    auto data = version.constData();
+    int i = 0;
+    while (i < versionEnd && isDigit(data[i].unicode()))
+    {
+        ++i;
+    }
+    if (i > 0 && i < versionEnd && data[i] == QChar(':'))
+    {
+        for (int j = 0; j < i; ++j)
+        {
+            epoch = epoch * 10 + (data[j].unicode() - '0');
+        }
+        versionBegin = i + 1;
+    }
+
+    for (int j = versionEnd - 1; j >= versionBegin; --j)
+    {
+        if (data[j] == QChar('-'))
+        {
+            versionEnd = j;
+            releaseBegin = j + 1;
+            break;
+        }
+    }
+}
 
 QString OrnPackageVersion::packageId(const QString &name) const
 {
@@ -58,27 +239,33 @@ bool OrnPackageVersion::operator ==(const OrnPackageVersion &other) const
 
 bool OrnPackageVersion::operator <(const OrnPackageVersion &other) const
 {
-    if (versionParts == other.versionParts)
+    return this->compare(other) < 0;
+}
+
+/*!
+    Compares versions as rpm does: by epoch, version and release.
+    A version without a release is considered older.
+ */
+int OrnPackageVersion::compare(const OrnPackageVersion &other) const
+{
+    if (epoch != other.epoch)
     {
-        return false;
+        return epoch < other.epoch ? -1 : 1;
     }
 
-    auto leftSize  = versionParts.size();
-    auto rightSize = other.versionParts.size();
-    auto leftIsShorter = leftSize < rightSize;
-    auto shorterLength = leftIsShorter ? leftSize : rightSize;
-
-    // Compare the same parts
-    for (int i = 0; i < shorterLength; ++i)
+    auto data = version.constData();
+    auto otherData = other.version.constData();
+    auto res = rpmvercmp(data + versionBegin, data + versionEnd,
+                         otherData + other.versionBegin, otherData + other.versionEnd);
+    if (res != 0)
     {
-        const auto &lp = versionParts[i];
-        const auto &rp = other.versionParts[i];
-        if (lp != rp)
-        {
-            return lp < rp;
-        }
+        return res;
     }
 
-    // If the same parts are equal then the shorter version is lesser
-    return leftIsShorter;
+    if (releaseBegin < 0 || other.releaseBegin < 0)
+    {
+        return (releaseBegin >= 0) - (other.releaseBegin >= 0);
+    }
+    return rpmvercmp(data + releaseBegin, data + version.size(),
+                     otherData + other.releaseBegin, otherData + other.version.size());
 }
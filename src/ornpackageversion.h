@@ -2,7 +2,8 @@
 #define ORNPACKAGEVERSION_H
 
 
-#include <QVariantList>
+#include <QMetaType>
+#include <QHash>
 
 struct OrnPackageVersion
 {
@@ -25,12 +26,24 @@ struct OrnPackageVersion
 
     bool operator <(const OrnPackageVersion &other) const;
 
+    int compare(const OrnPackageVersion &other) const;
+
 private:
-    QVariantList versionParts;
+    void parseVersion();
+
+    // The epoch and the bounds of the version and release parts
+    // of the "[epoch:]version[-release]" string
+    quint32 epoch;
+    int versionBegin;
+    int versionEnd;
+    int releaseBegin;
 };
 
 typedef QList<OrnPackageVersion> OrnPackageVersionList;
+// <package name, versions>
+typedef QHash<QString, OrnPackageVersionList> OrnPackageVersionHash;
 
 Q_DECLARE_METATYPE(QList<OrnPackageVersion>)
+Q_DECLARE_METATYPE(OrnPackageVersionHash)
 
 #endif // ORNPACKAGEVERSION_H
@@ -0,0 +1,231 @@
+#include "ornpktransaction.h"
+#include "ornpm_p.h"
+
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusPendingCallWatcher>
+
+#include <Transaction>
+
+#include <QDebug>
+
+// PackageKit uses 101 for unknown percentage
+#define PK_PERCENTAGE_UNKNOWN 101
+
+OrnPkTransaction::OrnPkTransaction(QObject *parent)
+    : QObject(parent)
+    , mFinished(false)
+    , mPathTime(-1)
+    , mPhaseStart(0)
+    , mStatus(PackageKit::Transaction::StatusUnknown)
+    , mPercentage(PK_PERCENTAGE_UNKNOWN)
+    , mSpeed(0)
+    , mMaxSpeed(0)
+    , mDownloadSizeRemaining(0)
+{
+    mTimer.start();
+}
+
+QString OrnPkTransaction::path() const
+{
+    return mPath;
+}
+
+/*!
+    Connects to the signals of the transaction with the \a path and sends
+    the queued calls.
+ */
+void OrnPkTransaction::setPath(const QString &path)
+{
+    Q_ASSERT_X(mPath.isEmpty(), Q_FUNC_INFO, "The transaction path is already set");
+    mPath = path;
+    mPathTime = mTimer.elapsed();
+    mPhaseStart = mPathTime;
+
+    auto bus = QDBusConnection::systemBus();
+    bus.connect(PK_SERVICE, mPath, PK_TR_INTERFACE, QStringLiteral("Finished"),
+                this, SLOT(onFinished(quint32,quint32)));
+    bus.connect(PK_SERVICE, mPath, PK_TR_INTERFACE, QStringLiteral("ErrorCode"),
+                this, SLOT(onErrorCode(quint32,QString)));
+    bus.connect(PK_SERVICE, mPath, PK_TR_INTERFACE, QStringLiteral("Package"),
+                this, SLOT(onPackage(quint32,QString,QString)));
+    bus.connect(PK_SERVICE, mPath, QStringLiteral("org.freedesktop.DBus.Properties"),
+                QStringLiteral("PropertiesChanged"),
+                this, SLOT(onPropertiesChanged(QString,QVariantMap,QStringList)));
+
+    for (const auto &call : mQueue)
+    {
+        this->send(call.first, call.second);
+    }
+    mQueue.clear();
+}
+
+/*!
+    Finishes the transaction with an error if it could not be created
+    or PackageKit rejected a method call.
+ */
+void OrnPkTransaction::fail(const QString &details)
+{
+    qWarning() << "Transaction" << mPath << "failed:" << details;
+    mQueue.clear();
+    if (mFinished)
+    {
+        return;
+    }
+    mFinished = true;
+    emit this->ErrorCode(PackageKit::Transaction::ErrorInternalError, details);
+    emit this->Finished(PackageKit::Transaction::ExitFailed, 0);
+}
+
+void OrnPkTransaction::asyncCall(const QString &method, const QVariant &arg1, const QVariant &arg2,
+                                 const QVariant &arg3, const QVariant &arg4)
+{
+    // Invalid arguments are skipped as QDBusAbstractInterface does
+    QVariantList args;
+    for (const auto &arg : { arg1, arg2, arg3, arg4 })
+    {
+        if (arg.isValid())
+        {
+            args << arg;
+        }
+    }
+    this->asyncCallWithArgumentList(method, args);
+}
+
+void OrnPkTransaction::asyncCallWithArgumentList(const QString &method, const QVariantList &args)
+{
+    if (mPath.isEmpty())
+    {
+        mQueue << qMakePair(method, args);
+    }
+    else
+    {
+        this->send(method, args);
+    }
+}
+
+/*!
+    Returns the current progress of the transaction: percentage (101 if unknown),
+    status, speed in bytes per second, remaining download size and the time in
+    msec spent in each of the statuses.
+ */
+QVariantMap OrnPkTransaction::progress() const
+{
+    auto phases = mPhases;
+    if (!mPath.isEmpty())
+    {
+        auto key = QString::number(mStatus);
+        phases.insert(key, phases.value(key).toLongLong() + mTimer.elapsed() - mPhaseStart);
+    }
+    return {
+        { QStringLiteral("percentage"),            mPercentage },
+        { QStringLiteral("status"),                mStatus },
+        { QStringLiteral("speed"),                 mSpeed },
+        { QStringLiteral("downloadSizeRemaining"), mDownloadSizeRemaining },
+        { QStringLiteral("phases"),                phases }
+    };
+}
+
+/*!
+    Returns a record for the transaction log.
+ */
+QVariantMap OrnPkTransaction::summary(quint32 exit, quint32 runtime) const
+{
+    return {
+        { QStringLiteral("methods"),  mMethods },
+        { QStringLiteral("exit"),     exit },
+        { QStringLiteral("runtime"),  runtime },
+        { QStringLiteral("elapsed"),  mTimer.elapsed() },
+        { QStringLiteral("pathTime"), mPathTime },
+        { QStringLiteral("maxSpeed"), mMaxSpeed },
+        { QStringLiteral("phases"),   mPhases }
+    };
+}
+
+void OrnPkTransaction::finishPhase()
+{
+    auto now = mTimer.elapsed();
+    auto key = QString::number(mStatus);
+    mPhases.insert(key, mPhases.value(key).toLongLong() + now - mPhaseStart);
+    mPhaseStart = now;
+}
+
+void OrnPkTransaction::send(const QString &method, const QVariantList &args)
+{
+    mMethods << method;
+    auto message = QDBusMessage::createMethodCall(PK_SERVICE, mPath, PK_TR_INTERFACE, method);
+    message.setArguments(args);
+    auto watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [this, watcher, method]()
+    {
+        watcher->deleteLater();
+        if (!watcher->isError())
+        {
+            return;
+        }
+        // A rejected call does not start the transaction, so it would never finish.
+        // Cancel fails for a transaction which has already finished, that is fine.
+        auto details = watcher->error().message();
+        if (method == QLatin1String("Cancel"))
+        {
+            qWarning() << "Could not cancel transaction" << mPath << "-" << details;
+            return;
+        }
+        this->fail(details);
+    });
+}
+
+void OrnPkTransaction::onFinished(quint32 exit, quint32 runtime)
+{
+    if (mFinished)
+    {
+        return;
+    }
+    mFinished = true;
+    this->finishPhase();
+    emit this->Finished(exit, runtime);
+}
+
+void OrnPkTransaction::onErrorCode(quint32 code, const QString &details)
+{
+    emit this->ErrorCode(code, details);
+}
+
+void OrnPkTransaction::onPackage(quint32 info, const QString &packageId, const QString &summary)
+{
+    emit this->Package(info, packageId, summary);
+}
+
+void OrnPkTransaction::onPropertiesChanged(const QString &interface, const QVariantMap &changed,
+                                           const QStringList &invalidated)
+{
+    Q_UNUSED(invalidated)
+    if (interface != PK_TR_INTERFACE)
+    {
+        return;
+    }
+
+    auto it = changed.find(QStringLiteral("Status"));
+    if (it != changed.cend() && it->toUInt() != mStatus)
+    {
+        this->finishPhase();
+        mStatus = it->toUInt();
+    }
+    it = changed.find(QStringLiteral("Percentage"));
+    if (it != changed.cend())
+    {
+        mPercentage = it->toUInt();
+    }
+    it = changed.find(QStringLiteral("Speed"));
+    if (it != changed.cend())
+    {
+        mSpeed = it->toUInt();
+        mMaxSpeed = qMax(mMaxSpeed, mSpeed);
+    }
+    it = changed.find(QStringLiteral("DownloadSizeRemaining"));
+    if (it != changed.cend())
+    {
+        mDownloadSizeRemaining = it->toULongLong();
+    }
+    emit this->progressChanged();
+}
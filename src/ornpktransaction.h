@@ -0,0 +1,77 @@
+#ifndef ORNPKTRANSACTION_H
+#define ORNPKTRANSACTION_H
+
+#include <QObject>
+#include <QVariant>
+#include <QElapsedTimer>
+
+/*!
+    A proxy of a PackageKit transaction.
+
+    Unlike QDBusInterface it does not introspect the remote object and can be
+    used before the transaction path is known: method calls are queued and sent
+    when the path is set. The D-Bus signals of the transaction are re-emitted
+    with the same signatures.
+
+    It also tracks the progress properties of the transaction and the time
+    spent in each of its statuses.
+ */
+class OrnPkTransaction : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OrnPkTransaction(QObject *parent = nullptr);
+
+    QString path() const;
+    void setPath(const QString &path);
+    void fail(const QString &details);
+
+    void asyncCall(const QString &method,
+                   const QVariant &arg1 = QVariant(),
+                   const QVariant &arg2 = QVariant(),
+                   const QVariant &arg3 = QVariant(),
+                   const QVariant &arg4 = QVariant());
+    void asyncCallWithArgumentList(const QString &method, const QVariantList &args);
+
+    QVariantMap progress() const;
+    QVariantMap summary(quint32 exit, quint32 runtime) const;
+
+signals:
+    void progressChanged();
+    void Finished(quint32 exit, quint32 runtime);
+    void ErrorCode(quint32 code, const QString &details);
+    void Package(quint32 info, const QString &packageId, const QString &summary);
+
+    // QDBusConnection can deliver signals only to public slots
+public slots:
+    void onFinished(quint32 exit, quint32 runtime);
+    void onErrorCode(quint32 code, const QString &details);
+    void onPackage(quint32 info, const QString &packageId, const QString &summary);
+    void onPropertiesChanged(const QString &interface, const QVariantMap &changed,
+                             const QStringList &invalidated);
+
+private:
+    void send(const QString &method, const QVariantList &args);
+    void finishPhase();
+
+    QString mPath;
+    // Set when Finished was emitted, a failed call and PackageKit could both finish it
+    bool    mFinished;
+    // Calls made before the path was set, <method, arguments>
+    QList<QPair<QString, QVariantList>> mQueue;
+    QStringList mMethods;
+    QElapsedTimer mTimer;
+    // Time in msec to receive the path
+    qint64  mPathTime;
+    // The time when the current status was set and <status, msec> of all statuses
+    qint64  mPhaseStart;
+    QVariantMap mPhases;
+    quint32 mStatus;
+    quint32 mPercentage;
+    quint32 mSpeed;
+    quint32 mMaxSpeed;
+    quint64 mDownloadSizeRemaining;
+};
+
+#endif // ORNPKTRANSACTION_H
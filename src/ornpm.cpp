@@ -4,9 +4,23 @@
 #include "orn.h"
 
 #include <solv/repo_solv.h>
+#include <solv/evr.h>
 #include <connman-qt5/networkmanager.h>
 
 #include <QtConcurrent/QtConcurrent>
+#include <QSaveFile>
+#include <QThread>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusPendingReply>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 #include <QDebug>
 
@@ -41,6 +55,24 @@ OrnPm::OrnPm(QObject *parent)
 
 OrnPmPrivate::OrnPmPrivate(OrnPm *ornPm)
     : initialised(false)
+    , stale(false)
+    , pkPrefetching(false)
+    , updatesRunning(false)
+    , updatesPending(false)
+    , updatesConfirmed(false)
+    , updatesGeneration(0)
+    , state(new OrnPmState)
+    , packageJob(nullptr)
+    , refreshJobsLimit(REFRESH_JOBS_LIMIT)
+    , refreshTimeout(REFRESH_TIMEOUT)
+    , refreshTotal(0)
+    , refreshFinished(0)
+    , refreshBulkJob(nullptr)
+    , refreshRepoTime(REFRESH_REPO_TIME)
+    , refreshBulkTime(REFRESH_BULK_TIME)
+    , solvPool(pool_create())
+    , solvGeneration(0)
+    , solvIndexGeneration(0)
     , q_ptr(ornPm)
 {
     auto bus = QDBusConnection::systemBus();
@@ -48,9 +80,63 @@ OrnPmPrivate::OrnPmPrivate(OrnPm *ornPm)
     QString service(SSU_SERVICE);
     ssuInterface = new QDBusInterface(service, SSU_PATH, service, bus, q_ptr);
 
+    // Ssu::DeviceModel = 1
+    qDebug().nospace() << "Calling " << ssuInterface << "->" SSU_METHOD_DISPLAYNAME "(1)";
+    auto modelWatcher = new QDBusPendingCallWatcher(
+                ssuInterface->asyncCall(QStringLiteral(SSU_METHOD_DISPLAYNAME), 1), q_ptr);
+    QObject::connect(modelWatcher, &QDBusPendingCallWatcher::finished, [this, modelWatcher]()
+    {
+        QDBusPendingReply<QString> reply(*modelWatcher);
+        if (reply.isError())
+        {
+            qWarning() << "Could not get device model:" << reply.error().message();
+        }
+        else
+        {
+            deviceModel = reply.value();
+            emit q_ptr->deviceModelChanged();
+        }
+        modelWatcher->deleteLater();
+    });
+
     service = PK_SERVICE;
     pkInterface = new QDBusInterface(service, PK_PATH, service, bus, q_ptr);
-    QObject::connect(pkInterface, SIGNAL(UpdatesChanged()), q_ptr, SLOT(getUpdates()));
+    updatesTimer = new QTimer(q_ptr);
+    updatesTimer->setSingleShot(true);
+    updatesTimer->setInterval(UPDATES_COALESCE_INTERVAL);
+    QObject::connect(updatesTimer, &QTimer::timeout, q_ptr, &OrnPm::getUpdates);
+    QObject::connect(pkInterface, SIGNAL(UpdatesChanged()), updatesTimer, SLOT(start()));
+
+    versionsTimer = new QTimer(q_ptr);
+    versionsTimer->setSingleShot(true);
+    versionsTimer->setInterval(VERSIONS_COALESCE_INTERVAL);
+    QObject::connect(versionsTimer, &QTimer::timeout, q_ptr, &OrnPm::resolvePackageVersions);
+
+    // Transactions report progress too often to update the operations on each change
+    progressTimer = new QTimer(q_ptr);
+    progressTimer->setSingleShot(true);
+    progressTimer->setInterval(PROGRESS_COALESCE_INTERVAL);
+    QObject::connect(progressTimer, &QTimer::timeout, q_ptr, &OrnPm::operationsChanged);
+
+    // Track packages installed and removed by other tools
+    installedTimer = new QTimer(q_ptr);
+    installedTimer->setSingleShot(true);
+    installedTimer->setInterval(INSTALLED_RELOAD_DELAY);
+    QObject::connect(installedTimer, &QTimer::timeout, q_ptr, &OrnPm::reloadInstalledPackages);
+    QString installedPath(SOLV_INSTALLED);
+    installedWatcher = new QFileSystemWatcher(q_ptr);
+    installedWatcher->addPath(installedPath);
+    installedWatcher->addPath(QFileInfo(installedPath).path());
+    QObject::connect(installedWatcher, &QFileSystemWatcher::fileChanged,
+                     q_ptr, &OrnPm::onInstalledSolvChanged);
+    QObject::connect(installedWatcher, &QFileSystemWatcher::directoryChanged,
+                     q_ptr, &OrnPm::onInstalledSolvChanged);
+}
+
+OrnPmPrivate::~OrnPmPrivate()
+{
+    QMutexLocker locker(&solvMutex);
+    pool_free(solvPool);
 }
 
 OrnPm::~OrnPm()
@@ -63,26 +149,41 @@ OrnPm *OrnPm::instance()
     if (!g_instance)
     {
         g_instance = new OrnPm(qApp);
-        auto fw = new QFutureWatcher<void>(g_instance);
-        connect(fw, &QFutureWatcher<void>::finished, [fw]()
+        auto d = g_instance->d_ptr;
+        // Use the state from the previous launch until it is revalidated
+        if (d->loadSnapshot())
+        {
+            d->initialised = true;
+            d->stale = true;
+        }
+        typedef OrnPmPrivate::Initialisation Initialisation;
+        auto fw = new QFutureWatcher<Initialisation>(g_instance);
+        connect(fw, &QFutureWatcher<Initialisation>::finished, [fw, d]()
         {
+            d->finishInitialisation(fw->result());
             fw->deleteLater();
+            d->saveSnapshot();
             OrnPm::instance()->getUpdates();
         });
-        fw->setFuture(QtConcurrent::run(g_instance->d_ptr, &OrnPmPrivate::initialise));
+        connect(qApp, &QCoreApplication::aboutToQuit, [d]()
+        {
+            d->saveSnapshot();
+        });
+        fw->setFuture(QtConcurrent::run(d, &OrnPmPrivate::initialise, d->state));
     }
     return g_instance;
 }
 
-void OrnPmPrivate::initialise()
+OrnPmPrivate::Initialisation OrnPmPrivate::initialise(const StatePtr &current)
 {
+    Initialisation init;
     qDebug() << "Getting the list of ORN repositories";
 
     // NOTE: A hack for SSU repos. Can break on ssu config changes.
     QSettings ssuSettings(SSU_CONFIG_PATH, QSettings::IniFormat);
 
-    archs << ssuSettings.value(QStringLiteral("arch")).toString()
-          << QStringLiteral("noarch");
+    init.archs << ssuSettings.value(QStringLiteral("arch")).toString()
+               << QStringLiteral("noarch");
 
     auto disabled = ssuSettings.value(SSU_DISABLED_KEY).toStringList().toSet();
     ssuSettings.beginGroup(SSU_REPOS_GROUP);
@@ -94,430 +195,1586 @@ void OrnPmPrivate::initialise()
         {
             auto enabled = !disabled.contains(alias);
             qDebug() << "Found" << (enabled ? "enabled" : "disabled") << "repo" << alias;
-            repos.insert(alias, enabled);
+            init.repos.insert(alias, enabled);
         }
     }
-    qDebug() << "System has" << repos.size() << "ORN repositories";
+    qDebug() << "System has" << init.repos.size() << "ORN repositories";
 
     qDebug() << "Getting the list of installed packages";
-    auto spool = pool_create();
-    auto srepo = repo_create(spool, "installed");
-
-    auto sfile = fopen(SOLV_INSTALLED, "r");
-    if (!sfile)
+    QMutexLocker locker(&solvMutex);
+    if (this->syncSolvRepo(SOLV_INSTALLED_ALIAS, QStringLiteral(SOLV_INSTALLED)))
     {
-        qCritical() << "Could not read " SOLV_INSTALLED;
-        repo_free(srepo, 0);
-        pool_free(spool);
-        return;
+        ++solvGeneration;
+    }
+    if (!solvRepos.contains(SOLV_INSTALLED_ALIAS))
+    {
+        return init;
     }
 
-    repo_add_solv(srepo, sfile, 0);
-    fclose(sfile);
+    auto &diff = init.installed;
+    diff.reloaded = true;
+    diff.installed = this->readInstalledPackages();
 
-    for (int i = 0; i < spool->nsolvables; ++i)
+    // The index is also needed to save only ORN packages in the snapshot
+    OrnPmState indexState;
+    indexState.archs = init.archs;
+    indexState.repos = init.repos;
+    this->updateSolvIndex(indexState);
+
+    // Notify about ORN packages changed since the snapshot was saved,
+    // the snapshot does not keep the other installed packages
+    if (stale)
     {
-        auto s = &spool->solvables[i];
-        QString name(solvable_lookup_str(s, SOLVABLE_NAME));
-        if (name.size() > 0)
+        auto ornNames = this->ornNameIds();
+        for (const auto &name : current->installed.diff(diff.installed))
         {
-            auto id = QStringLiteral("%1;%2;%3;installed").arg(
-                        name, solvable_lookup_str(s, SOLVABLE_EVR), solvable_lookup_str(s, SOLVABLE_ARCH));
-            installedPackages.insert(name, id);
+            if (ornNames.contains(pool_str2id(solvPool, name.toUtf8().constData(), 0)))
+            {
+                diff.changed << name;
+            }
         }
     }
+    locker.unlock();
+    init.ok = true;
+    return init;
+}
 
-    repo_free(srepo, 0);
-    pool_free(spool);
-
-    qDebug() << installedPackages.size() << "packages are installed";
+void OrnPmPrivate::finishInitialisation(const Initialisation &init)
+{
+    // The repos are actual even if the installed packages could not be read
+    auto newState = this->copyState();
+    newState->archs = init.archs;
+    newState->repos = init.repos;
+    if (init.installed.reloaded)
+    {
+        newState->installed = init.installed.installed;
+    }
+    this->publishState(newState);
+    if (init.ok)
+    {
+        qDebug() << state->installed.size() << "packages are installed";
+    }
+    else
+    {
+        // Keep the installed packages from the snapshot and read them again soon
+        qWarning() << "Could not read installed packages, using" << state->installed.size()
+                   << "packages from the snapshot";
+        installedTimer->start();
+    }
 
     qDebug() << "Initialisation finished";
     initialised = true;
+    stale = false;
     emit q_ptr->initialisedChanged();
-}
-
-bool OrnPm::initialised() const
-{
-    return d_ptr->initialised;
-}
-
-QVariantList OrnPm::operations() const
-{
-    QVariantList res;
-    for (auto op = d_ptr->operations.cbegin(); op != d_ptr->operations.cend(); ++op)
+    for (const auto &name : init.installed.changed)
     {
-        res << QVariantMap{
-            { QStringLiteral("item"),      op.key() },
-            { QStringLiteral("operation"), op.value() }
-        };
+        emit q_ptr->packageStatusChanged(name, q_ptr->packageStatus(name));
     }
-    return res;
 }
 
-QString OrnPm::deviceModel() const
+/*!
+    Returns a copy of the current state to be modified and published.
+ */
+QSharedPointer<OrnPmState> OrnPmPrivate::copyState() const
 {
-    // Ssu::DeviceModel = 1
-    qDebug().nospace() << "Calling " << d_ptr->ssuInterface << "->" SSU_METHOD_DISPLAYNAME "(1)";
-    auto call = d_ptr->ssuInterface->call(QDBus::BlockWithGui, QStringLiteral(SSU_METHOD_DISPLAYNAME), 1);
-    return call.arguments().first().toString();
+    return QSharedPointer<OrnPmState>(new OrnPmState(*state));
 }
 
-bool OrnPm::updatesAvailable() const
+/*!
+    Replaces the current state. Workers that are running keep their old copies.
+ */
+void OrnPmPrivate::publishState(const QSharedPointer<OrnPmState> &newState)
 {
-    return d_ptr->updatablePackages.size();
+    Q_ASSERT_X(QThread::currentThread() == q_ptr->thread(), Q_FUNC_INFO,
+               "The state must be published only from the GUI thread");
+    state = newState;
 }
 
-QStringList OrnPm::updatablePackages() const
+/*!
+    Reads the state saved by the previous launch, so OrnPm can be used right
+    away while the actual state is being read. Returns true on success.
+ */
+bool OrnPmPrivate::loadSnapshot()
 {
-    return d_ptr->updatablePackages.keys();
+    auto path = Orn::locate(PM_SNAPSHOT_FILE);
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 version = 0;
+    stream >> version;
+    if (version != PM_SNAPSHOT_VERSION)
+    {
+        qWarning() << "Skipping snapshot" << path << "of version" << version;
+        return false;
+    }
+
+    QSharedPointer<OrnPmState> newState(new OrnPmState);
+    stream >> newState->archs >> newState->repos >> newState->installed
+           >> newState->updatable;
+    if (stream.status() != QDataStream::Ok)
+    {
+        qWarning() << "Could not read snapshot" << path;
+        return false;
+    }
+
+    this->publishState(newState);
+    qDebug() << "Loaded snapshot with" << state->repos.size() << "repos,"
+             << state->installed.size() << "installed and"
+             << state->updatable.size() << "updatable packages";
+    return true;
 }
 
-OrnPm::RepoStatus OrnPm::repoStatus(const QString &alias) const
+void OrnPmPrivate::saveSnapshot()
 {
-    if (d_ptr->repos.contains(alias))
+    if (!initialised || stale)
     {
-        return d_ptr->repos[alias] ? RepoEnabled : RepoDisabled;
+        return;
+    }
+
+    // Only ORN packages are saved. Do not wait for a worker that is parsing
+    // solv files and do not build the index here, try next time instead.
+    if (!solvMutex.tryLock())
+    {
+        qDebug() << "Solv pool is busy, skipping snapshot";
+        return;
+    }
+    if (solvIndexGeneration != solvGeneration || !solvPool->installed)
+    {
+        solvMutex.unlock();
+        qDebug() << "Solv index is not actual, skipping snapshot";
+        return;
+    }
+    auto ornNames = this->ornNameIds();
+    StringSet ornPackages;
+    Id p;
+    Solvable *s;
+    FOR_REPO_SOLVABLES(solvPool->installed, p, s)
+    {
+        if (ornNames.contains(s->name))
+        {
+            ornPackages.insert(QString::fromUtf8(pool_id2str(solvPool, s->name)));
+        }
+    }
+    solvMutex.unlock();
+
+    auto path = Orn::locate(PM_SNAPSHOT_FILE);
+    QSaveFile file(path);
+    if (!file.open(QFile::WriteOnly))
+    {
+        qWarning() << "Could not write snapshot" << path;
+        return;
+    }
+    QDataStream stream(&file);
+    stream << PM_SNAPSHOT_VERSION << state->archs << state->repos
+           << state->installed.filtered(ornPackages) << state->updatable;
+    if (file.commit())
+    {
+        qDebug() << "Snapshot was written to" << path;
     }
-    return RepoNotInstalled;
 }
 
 /*!
-    This will never return \l OrnPm::PackageAvailable.
+    Checks if the solv file of the repo \a alias has changed since the last load
+    and unloads the outdated repo. Returns false if the loaded repo is actual
+    or if the file could not be loaded before and has not changed since then.
+    Call only with solvMutex locked.
  */
-OrnPm::PackageStatus OrnPm::packageStatus(const QString &packageName) const
+bool OrnPmPrivate::checkSolvRepo(const QString &alias, const QString &path, SolvFile &file)
 {
-    if (d_ptr->operations.contains(packageName))
+    QFileInfo info(path);
+    file.alias = alias;
+    file.path  = path;
+    file.mtime = info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+    file.size  = info.size();
+
+    auto it = solvRepos.find(alias);
+    if (it != solvRepos.end())
     {
-        switch (d_ptr->operations[packageName])
+        if (it->mtime == file.mtime && it->size == file.size)
         {
-        case InstallingPackage:
-            return PackageInstalling;
-        case RemovingPackage:
-            return PackageRemoving;
-        case UpdatingPackage:
-            return PackageUpdating;
-        default:
-            Q_UNREACHABLE();
+            return false;
         }
+        qDebug() << "Solv file" << path << "has changed, reloading";
+        repo_free(it->repo, 0);
+        solvRepos.erase(it);
+        return true;
     }
+    return solvFailed.value(alias, qMakePair(qint64(-1), qint64(-1))) !=
+            qMakePair(file.mtime, file.size);
+}
 
-    if (d_ptr->updatablePackages.contains(packageName))
+/*!
+    Maps the solv \a file to memory and asks the kernel to read it ahead.
+    Can be called from any thread.
+ */
+void OrnPmPrivate::mapSolvFile(SolvFile &file)
+{
+    auto fd = ::open(file.path.toUtf8().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
     {
-        return PackageUpdateAvailable;
+        return;
     }
-    if (d_ptr->installedPackages.contains(packageName))
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
     {
-        return PackageInstalled;
+        auto map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            ::madvise(map, st.st_size, MADV_WILLNEED);
+            file.map = map;
+            file.mapSize = st.st_size;
+        }
     }
-    return PackageNotInstalled;
+    ::close(fd);
 }
 
-QDBusInterface *OrnPmPrivate::transaction(const QString &item)
+/*!
+    Adds the content of the mapped solv \a file to the pool and unmaps it.
+    Returns false on errors. Call only with solvMutex locked.
+ */
+bool OrnPmPrivate::addSolvRepo(SolvFile &file)
 {
-    auto reply = pkInterface->call(QStringLiteral("CreateTransaction"));
-    Q_ASSERT_X(reply.type() != QDBusMessage::ErrorMessage, Q_FUNC_INFO,
-               qPrintable(reply.errorName().append(": ").append(reply.errorMessage())));
+    // Remember the file as failed until it is loaded successfully
+    solvFailed.insert(file.alias, qMakePair(file.mtime, file.size));
+    if (!file.map)
+    {
+        qCritical() << "Could not read" << file.path;
+        return false;
+    }
 
-    auto t = new QDBusInterface(PK_SERVICE,
-                                qvariant_cast<QDBusObjectPath>(reply.arguments().first()).path(),
-                                PK_TR_INTERFACE,
-                                QDBusConnection::systemBus(),
-                                q_ptr);
-    Q_ASSERT(t->isValid());
-#ifdef QT_DEBUG
-    QObject::connect(t, SIGNAL(Finished(quint32,quint32)),  q_ptr, SLOT(onTransactionFinished(quint32,quint32)));
-    QObject::connect(t, SIGNAL(ErrorCode(quint32,QString)), q_ptr, SLOT(emitError(quint32,QString)));
-#else
-    QObject::connect(t, SIGNAL(Finished(quint32, quint32)), t, SLOT(deleteLater()));
-    QObject::connect(t, SIGNAL(ErrorCode(quint32,QString)), q_ptr, SIGNAL(error(quint32,QString)));
-#endif
-    if (!item.isEmpty())
+    // libsolv reads the mapping without copying it, "r" mode never writes to the buffer
+    auto sfile = fmemopen(file.map, file.mapSize, "r");
+    Repo *srepo = nullptr;
+    int res = -1;
+    if (sfile)
     {
-        transactionHash.insert(t, item);
+        srepo = repo_create(solvPool, file.alias.toUtf8().constData());
+        res = repo_add_solv(srepo, sfile, 0);
+        fclose(sfile);
     }
-    return t;
-}
+    ::munmap(file.map, file.mapSize);
+    file.map = nullptr;
 
-#ifdef QT_DEBUG
-void OrnPm::onTransactionFinished(quint32 exit, quint32 runtime)
-{
-    qDebug() << this->sender()
-             << (exit == Transaction::ExitSuccess ? "finished in" : "failed after")
-             << runtime << "msec";
-    this->sender()->deleteLater();
-}
+    if (!sfile)
+    {
+        qCritical() << "Could not open" << file.path;
+        return false;
+    }
+    if (res != 0)
+    {
+        qCritical() << "Could not parse" << file.path << "-" << pool_errstr(solvPool);
+        repo_free(srepo, 0);
+        return false;
+    }
 
-void OrnPm::emitError(quint32 code, const QString& details)
-{
-    qDebug() << this->sender() << "error code" << code << "-" << details;
-    emit this->error(code, details);
+    if (file.alias == SOLV_INSTALLED_ALIAS)
+    {
+        pool_set_installed(solvPool, srepo);
+    }
+    solvRepos.insert(file.alias, SolvRepo{ srepo, file.mtime, file.size });
+    solvFailed.remove(file.alias);
+    return true;
 }
-#endif
 
-void OrnPm::getUpdates()
+/*!
+    Loads the solv file \a path to the pool as a repo \a alias or reloads it
+    if the file modification time or size has changed since the last load.
+    Returns true if the pool was modified. Call only with solvMutex locked
+    and increase the solvGeneration if the pool was modified.
+ */
+bool OrnPmPrivate::syncSolvRepo(const QString &alias, const QString &path)
 {
-    CHECK_NETWORK();
-    auto t = d_ptr->transaction();
-    connect(t, SIGNAL(Package(quint32,QString,QString)), this, SLOT(onPackageUpdate(quint32,QString,QString)));
-    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(onGetUpdatesFinished(quint32,quint32)));
-    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_GETUPDATES "(" << PK_FLAG_NONE << ")";
-    t->asyncCall(QStringLiteral(PK_METHOD_GETUPDATES), PK_FLAG_NONE);
+    SolvFile file;
+    bool loaded = solvRepos.contains(alias);
+    if (!this->checkSolvRepo(alias, path, file))
+    {
+        return false;
+    }
+    qDebug() << "Reading" << path;
+    OrnPmPrivate::mapSolvFile(file);
+    // The outdated repo was unloaded even if the new file could not be added
+    return this->addSolvRepo(file) || loaded;
 }
 
-void OrnPm::onPackageUpdate(quint32 info, const QString& packageId, const QString &summary)
+/*!
+    Synchronises the solv pool with the installed packages and the enabled
+    ORN repositories: removed and disabled repos are unloaded, new and changed
+    ones are (re)loaded. Returns true if the pool was modified.
+    Call only with solvMutex locked.
+ */
+bool OrnPmPrivate::updateSolvPool(const OrnPmState &current)
 {
-    Q_UNUSED(summary)
-    Q_ASSERT(info == Transaction::InfoEnhancement);
-    // Filter updates only for ORN packages
-    if (Orn::packageRepo(packageId).startsWith(repoNamePrefix))
+    const auto &repos = current.repos;
+    bool changed = false;
+
+    auto it = solvRepos.begin();
+    while (it != solvRepos.end())
     {
-        d_ptr->newUpdatablePackages.insert(Orn::packageName(packageId), packageId);
+        const auto &alias = it.key();
+        if (alias != SOLV_INSTALLED_ALIAS && !repos.value(alias, false))
+        {
+            qDebug() << "Unloading" << alias << "from the solv pool";
+            repo_free(it->repo, 0);
+            it = solvRepos.erase(it);
+            changed = true;
+        }
+        else
+        {
+            ++it;
+        }
     }
-}
 
-void OrnPm::onGetUpdatesFinished(quint32 status, quint32 runtime)
-{
-    Q_UNUSED(runtime)
-    if (status == Transaction::ExitSuccess)
+    QList<SolvFile> files;
+    auto check = [this, &files, &changed](const QString &alias, const QString &path)
     {
-        bool newupdates = false;
-        // If some client listen to packageStatusChanged() and want to take a package
-        // update ID we swap two hashes before the checks
-        d_ptr->updatablePackages.swap(d_ptr->newUpdatablePackages);
-        auto it = d_ptr->updatablePackages.begin();
-        while (it != d_ptr->updatablePackages.end())
-        {
-            auto &name = it.key();
-            auto &id   = it.value();
-            auto repo  = Orn::packageRepo(id);
-            // A walkaround to skip inactual updates from removed/disabled repos
-            if (!d_ptr->repos.contains(repo) || !d_ptr->repos[repo])
-            {
-                it = d_ptr->updatablePackages.erase(it);
-            }
-            else
-            {
-                // Check if the update is really new
-                if (!d_ptr->newUpdatablePackages.contains(name) ||
-                    d_ptr->newUpdatablePackages[name] != id)
-                {
-                    emit this->packageStatusChanged(name, OrnPm::PackageUpdateAvailable);
-                    newupdates = true;
-                }
-                ++it;
-            }
+        SolvFile file;
+        bool loaded = solvRepos.contains(alias);
+        if (this->checkSolvRepo(alias, path, file))
+        {
+            files << file;
+            // The outdated repo was unloaded
+            changed = changed || loaded;
         }
-        if (newupdates ||
-            (d_ptr->updatablePackages.size() != d_ptr->newUpdatablePackages.size()))
+    };
+    check(SOLV_INSTALLED_ALIAS, QStringLiteral(SOLV_INSTALLED));
+    QString solvTmpl(SOLV_PATH_TMPL);
+    for (auto rit = repos.cbegin(); rit != repos.cend(); ++rit)
+    {
+        if (rit.value())
         {
-            emit this->updatablePackagesChanged();
+            check(rit.key(), solvTmpl.arg(rit.key()));
         }
     }
-    d_ptr->newUpdatablePackages.clear();
-}
 
-void OrnPm::getPackageVersions(const QString &packageName)
-{
-    Q_ASSERT(!packageName.isEmpty());
-    CHECK_INITIALISED();
-    qDebug() << "Resolving package versions for" << packageName;
+    if (!files.isEmpty())
+    {
+        // Solv files are mapped and read ahead in parallel but the pool
+        // is not thread safe so the data is added to it sequentially
+        qDebug() << "Reading" << files.size() << "solv files";
+        QElapsedTimer timer;
+        timer.start();
+        QtConcurrent::blockingMap(files, &OrnPmPrivate::mapSolvFile);
+        auto readTime = timer.restart();
+        for (auto &f : files)
+        {
+            if (this->addSolvRepo(f))
+            {
+                changed = true;
+            }
+        }
+        qDebug() << "Solv files were read in" << readTime << "msec and parsed in"
+                 << timer.elapsed() << "msec";
+    }
 
-    QtConcurrent::run(d_ptr, &OrnPmPrivate::preparePackageVersions, packageName);
+    if (changed)
+    {
+        ++solvGeneration;
+        qDebug() << "Solv pool generation" << solvGeneration << "has"
+                 << solvRepos.size() << "repos";
+    }
+    return changed;
 }
 
-void OrnPmPrivate::preparePackageVersions(const QString &packageName)
+/*!
+    Updates the solv pool and rebuilds the name index and the arch ids
+    if the pool generation has changed. Call only with solvMutex locked.
+ */
+void OrnPmPrivate::updateSolvIndex(const OrnPmState &current)
 {
-    OrnPackageVersionList versions;
-    auto spool = pool_create();
-    auto srepo = repo_create(spool, "");
-
-    auto sfile = fopen(SOLV_INSTALLED, "r");
-    if (!sfile)
+    this->updateSolvPool(current);
+    if (solvIndexGeneration == solvGeneration && !solvNameIndex.isEmpty())
     {
-        qCritical() << "Could not read " SOLV_INSTALLED;
-        repo_free(srepo, 0);
-        pool_free(spool);
         return;
     }
-    repo_add_solv(srepo, sfile, 0);
-    fclose(sfile);
-    for (int i = 0; i < spool->nsolvables && versions.isEmpty(); ++i)
+
+    solvArchs.clear();
+    for (const auto &arch : current.archs)
+    {
+        solvArchs.insert(pool_str2id(solvPool, arch.toUtf8().constData(), 1));
+    }
+
+    solvNameIndex.clear();
+    for (auto it = solvRepos.cbegin(); it != solvRepos.cend(); ++it)
     {
-        auto s = &spool->solvables[i];
-        QString name(solvable_lookup_str(s, SOLVABLE_NAME));
-        if (name == packageName)
+        Id p;
+        Solvable *s;
+        FOR_REPO_SOLVABLES(it->repo, p, s)
         {
-            versions << OrnPackageVersion(
-                            0,
-                            solvable_lookup_num(s, SOLVABLE_INSTALLSIZE, 0),
-                            solvable_lookup_str(s, SOLVABLE_EVR),
-                            solvable_lookup_str(s, SOLVABLE_ARCH),
-                            QStringLiteral("installed"));
+            solvNameIndex[s->name].append(p);
         }
     }
-    repo_free(srepo, 0);
+    solvIndexGeneration = solvGeneration;
+    qDebug() << "Indexed" << solvNameIndex.size() << "package names";
+}
 
-    QString solvTmpl(SOLV_PATH_TMPL);
-    for (auto it = repos.cbegin(); it != repos.cend(); ++it)
+/*!
+    Returns ids of the package names which are provided by the ORN repos.
+    Call only with solvMutex locked after the solv index was updated.
+ */
+QSet<Id> OrnPmPrivate::ornNameIds() const
+{
+    QSet<Id> ornNames;
+    for (auto it = solvNameIndex.cbegin(); it != solvNameIndex.cend(); ++it)
     {
-        if (it.value())
+        for (const auto &p : it.value())
         {
-            auto alias = it.key();
-            auto spath = solvTmpl.arg(alias);
-            srepo = repo_create(spool, "");
-
-            qDebug() << "Reading" << spath;
-            auto sfile = fopen(spath.toUtf8().data(), "r");
-            if (!sfile)
-            {
-                qCritical() << "Could not read" << spath;
-                repo_free(srepo, 0);
-                continue;
-            }
-
-            repo_add_solv(srepo, sfile, 0);
-            fclose(sfile);
-            for (int i = 0; i < spool->nsolvables; ++i)
+            if (pool_id2solvable(solvPool, p)->repo != solvPool->installed)
             {
-                auto s = &spool->solvables[i];
-                if (packageName == solvable_lookup_str(s, SOLVABLE_NAME))
-                {
-                    QString arch = solvable_lookup_str(s, SOLVABLE_ARCH);
-                    if (archs.contains(arch))
-                    {
-                        versions << OrnPackageVersion(
-                                        solvable_lookup_num(s, SOLVABLE_DOWNLOADSIZE, 0),
-                                        solvable_lookup_num(s, SOLVABLE_INSTALLSIZE, 0),
-                                        solvable_lookup_str(s, SOLVABLE_EVR),
-                                        arch,
-                                        alias);
-                    }
-                }
+                ornNames.insert(it.key());
+                break;
             }
-            repo_free(srepo, 0);
         }
     }
-
-    pool_free(spool);
-    std::sort(versions.rbegin(), versions.rend());
-
-    qDebug() << "Finished resolving versions for package" << packageName;
-    emit q_ptr->packageVersions(packageName, versions);
+    return ornNames;
 }
 
-void OrnPm::installPackage(const QString &packageId)
+/*!
+    Returns a table of the packages from the installed repo.
+    Call only with solvMutex locked.
+ */
+OrnInstalledTable OrnPmPrivate::readInstalledPackages() const
 {
-    CHECK_NETWORK();
-    SET_OPERATION_ITEM(InstallingPackage, Orn::packageName(packageId));
+    OrnInstalledTable installed;
+    auto srepo = solvPool->installed;
+    if (!srepo)
+    {
+        return installed;
+    }
 
-    auto t = d_ptr->transaction(packageId);
-    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(onPackageInstalled(quint32,quint32)));
-    QStringList ids(packageId);
-    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_INSTALLPACKAGES "(" << PK_FLAG_NONE << ", " << ids << ")";
-    emit this->packageStatusChanged(Orn::packageName(packageId), OrnPm::PackageInstalling);
-    t->asyncCall(QStringLiteral(PK_METHOD_INSTALLPACKAGES), PK_FLAG_NONE, ids);
+    installed.reserve(srepo->nsolvables);
+    Id p;
+    Solvable *s;
+    FOR_REPO_SOLVABLES(srepo, p, s)
+    {
+        auto name = pool_id2str(solvPool, s->name);
+        if (*name)
+        {
+            installed.append(name, pool_id2str(solvPool, s->evr), pool_id2str(solvPool, s->arch));
+        }
+    }
+    installed.sort();
+    return installed;
 }
 
-void OrnPm::installFile(const QString &packageFile)
+/*!
+    Reloads the installed repo if its solv file has changed and compares
+    the new list of installed packages with the \a current one.
+ */
+OrnPmPrivate::InstalledDiff OrnPmPrivate::reloadInstalledPackages(const OrnInstalledTable &current)
 {
-    CHECK_NETWORK();
+    InstalledDiff diff;
 
-    auto t = d_ptr->transaction();
-    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(onPackageInstalled(quint32,quint32)));
-    QStringList files(packageFile);
-    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_INSTALLFILES "(" << PK_FLAG_NONE << ", " << files << ")";
-    t->asyncCall(QStringLiteral(PK_METHOD_INSTALLFILES), PK_FLAG_NONE, files);
+    QMutexLocker locker(&solvMutex);
+    diff.reloaded = this->syncSolvRepo(SOLV_INSTALLED_ALIAS, QStringLiteral(SOLV_INSTALLED));
+    if (!diff.reloaded)
+    {
+        return diff;
+    }
+    ++solvGeneration;
+    diff.installed = this->readInstalledPackages();
+    locker.unlock();
+
+    diff.changed = current.diff(diff.installed);
+    qDebug() << "Installed packages reloaded," << diff.changed.size() << "have changed";
+    return diff;
 }
 
-void OrnPm::onPackageInstalled(quint32 exit, quint32 runtime)
+void OrnPm::onInstalledSolvChanged()
 {
-    Q_UNUSED(runtime)
-    auto id = d_ptr->transactionHash.take(this->sender());
-    auto name = Orn::packageName(id);
-    d_ptr->operations.remove(name);
-    emit this->operationsChanged();
-    if (exit == Transaction::ExitSuccess)
+    // Watched files are removed from the watcher when they are replaced
+    auto watcher = d_ptr->installedWatcher;
+    QString path(SOLV_INSTALLED);
+    if (!watcher->files().contains(path) && QFileInfo(path).isFile())
     {
-        d_ptr->installedPackages[name] = id;
-        emit this->packageInstalled(name);
-        emit this->packageStatusChanged(name, OrnPm::PackageInstalled);
+        watcher->addPath(path);
     }
-    else
-    {
-        emit this->packageStatusChanged(name, OrnPm::PackageUnknownStatus);
+    // Wait until zypp finishes writing the file
+    d_ptr->installedTimer->start();
+}
+
+void OrnPm::reloadInstalledPackages()
+{
+    if (!d_ptr->initialised)
+    {
+        return;
+    }
+
+    typedef OrnPmPrivate::InstalledDiff InstalledDiff;
+    auto watcher = new QFutureWatcher<InstalledDiff>(this);
+    connect(watcher, &QFutureWatcher<InstalledDiff>::finished, [this, watcher]()
+    {
+        auto diff = watcher->result();
+        watcher->deleteLater();
+        if (!diff.reloaded)
+        {
+            return;
+        }
+        auto newState = d_ptr->copyState();
+        newState->installed = diff.installed;
+        d_ptr->publishState(newState);
+        for (const auto &name : diff.changed)
+        {
+            emit this->packageStatusChanged(name, this->packageStatus(name));
+        }
+        if (!diff.changed.isEmpty())
+        {
+            // Installed versions could change so updates are not actual anymore
+            d_ptr->estimateUpdates(false);
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(d_ptr, &OrnPmPrivate::reloadInstalledPackages,
+                                         d_ptr->state->installed));
+}
+
+bool OrnPm::initialised() const
+{
+    return d_ptr->initialised;
+}
+
+/*!
+    Returns a list of maps with an item and its operation. Items which are
+    being processed by a transaction also have its progress.
+ */
+QVariantList OrnPm::operations() const
+{
+    QVariantList res;
+    auto transactions = d_ptr->itemTransactions();
+    for (auto op = d_ptr->operations.cbegin(); op != d_ptr->operations.cend(); ++op)
+    {
+        QVariantMap operation{
+            { QStringLiteral("item"),      op.key() },
+            { QStringLiteral("operation"), op.value() }
+        };
+        auto t = transactions.value(op.key());
+        if (t)
+        {
+            operation.unite(t->progress());
+        }
+        res << operation;
+    }
+    return res;
+}
+
+/*!
+    Returns summaries of the last finished transactions for profiling.
+ */
+QVariantList OrnPm::transactionLog() const
+{
+    QVariantList res;
+    for (const auto &record : d_ptr->transactionLog)
+    {
+        res << record;
+    }
+    return res;
+}
+
+/*!
+    Returns the device model name or an empty string until it is received from ssu.
+ */
+QString OrnPm::deviceModel() const
+{
+    return d_ptr->deviceModel;
+}
+
+/*!
+    Returns the running and queued jobs in the order they are run. Each job is a map
+    with an operation, a list of items (package names or repo aliases) and a running flag.
+ */
+QVariantList OrnPm::queue() const
+{
+    QVariantList res;
+    auto addJob = [&res](Operation operation, const QStringList &items, bool running)
+    {
+        if (!items.isEmpty())
+        {
+            res << QVariantMap{
+                { QStringLiteral("operation"), operation },
+                { QStringLiteral("items"),     items },
+                { QStringLiteral("running"),   running }
+            };
+        }
+    };
+    auto packageNames = [](const QStringList &ids)
+    {
+        QStringList names;
+        for (const auto &id : ids)
+        {
+            names << Orn::packageName(id);
+        }
+        return names;
+    };
+
+    // The running job has no ids left when all its packages were reported as finished
+    auto running = d_ptr->transactionHash.value(d_ptr->packageJob);
+    if (d_ptr->packageJob && !running.isEmpty())
+    {
+        addJob(d_ptr->operations.value(Orn::packageName(running.first())),
+               packageNames(running), true);
+    }
+    addJob(RefreshingRepo, d_ptr->refreshBulkRepos + d_ptr->refreshJobs.values(), true);
+    for (const auto &job : d_ptr->packageJobs)
+    {
+        addJob(job.operation, packageNames(job.ids), false);
+    }
+    addJob(RefreshingRepo, d_ptr->reposToRefresh, false);
+    return res;
+}
+
+bool OrnPm::updatesAvailable() const
+{
+    return d_ptr->state->updatable.size();
+}
+
+QStringList OrnPm::updatablePackages() const
+{
+    return d_ptr->state->updatable.keys();
+}
+
+OrnPm::RepoStatus OrnPm::repoStatus(const QString &alias) const
+{
+    const auto &repos = d_ptr->state->repos;
+    auto it = repos.find(alias);
+    if (it != repos.cend())
+    {
+        return it.value() ? RepoEnabled : RepoDisabled;
+    }
+    return RepoNotInstalled;
+}
+
+/*!
+    This will never return \l OrnPm::PackageAvailable.
+ */
+OrnPm::PackageStatus OrnPm::packageStatus(const QString &packageName) const
+{
+    if (d_ptr->operations.contains(packageName))
+    {
+        switch (d_ptr->operations[packageName])
+        {
+        case InstallingPackage:
+            return PackageInstalling;
+        case RemovingPackage:
+            return PackageRemoving;
+        case UpdatingPackage:
+            return PackageUpdating;
+        default:
+            Q_UNREACHABLE();
+        }
+    }
+
+    const auto &st = *d_ptr->state;
+    if (st.updatable.contains(packageName))
+    {
+        return PackageUpdateAvailable;
+    }
+    if (st.installed.contains(packageName))
+    {
+        return PackageInstalled;
+    }
+    return PackageNotInstalled;
+}
+
+/*!
+    Returns a new transaction without blocking. A prefetched transaction is used
+    if there is one, otherwise the calls are queued until the transaction is created.
+ */
+OrnPkTransaction *OrnPmPrivate::transaction(const QStringList &items)
+{
+    auto t = new OrnPkTransaction(q_ptr);
+#ifdef QT_DEBUG
+    QObject::connect(t, SIGNAL(Finished(quint32,quint32)),  q_ptr, SLOT(onTransactionFinished(quint32,quint32)));
+    QObject::connect(t, SIGNAL(ErrorCode(quint32,QString)), q_ptr, SLOT(emitError(quint32,QString)));
+#else
+    QObject::connect(t, SIGNAL(Finished(quint32, quint32)), t, SLOT(deleteLater()));
+    QObject::connect(t, SIGNAL(ErrorCode(quint32,QString)), q_ptr, SIGNAL(error(quint32,QString)));
+#endif
+    if (!items.isEmpty())
+    {
+        transactionHash.insert(t, items);
+    }
+    // Connected before the callers' handlers so the items are still known
+    QObject::connect(t, &OrnPkTransaction::Finished, [this, t](quint32 exit, quint32 runtime)
+    {
+        this->logTransaction(t, exit, runtime);
+    });
+    QObject::connect(t, &OrnPkTransaction::progressChanged, [this]()
+    {
+        if (!progressTimer->isActive())
+        {
+            progressTimer->start();
+        }
+    });
+
+    // PackageKit drops transactions which are not used for a long time
+    if (!pkSparePath.isEmpty() && pkSpareTimer.elapsed() < PK_SPARE_TRANSACTION_TTL)
+    {
+        t->setPath(pkSparePath);
+        pkSparePath.clear();
+    }
+    else
+    {
+        pkSparePath.clear();
+        auto message = QDBusMessage::createMethodCall(
+                    PK_SERVICE, PK_PATH, PK_SERVICE, QStringLiteral("CreateTransaction"));
+        auto watcher = new QDBusPendingCallWatcher(
+                    QDBusConnection::systemBus().asyncCall(message), t);
+        QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [t, watcher]()
+        {
+            QDBusPendingReply<QDBusObjectPath> reply(*watcher);
+            if (reply.isError())
+            {
+                t->fail(reply.error().message());
+            }
+            else
+            {
+                t->setPath(reply.value().path());
+            }
+            watcher->deleteLater();
+        });
+    }
+    return t;
+}
+
+/*!
+    Returns <item, transaction> for packages and repos which are being processed.
+ */
+QHash<QString, OrnPkTransaction *> OrnPmPrivate::itemTransactions() const
+{
+    QHash<QString, OrnPkTransaction *> res;
+    for (auto it = transactionHash.cbegin(); it != transactionHash.cend(); ++it)
+    {
+        auto t = static_cast<OrnPkTransaction *>(it.key());
+        for (const auto &id : it.value())
+        {
+            res.insert(Orn::packageName(id), t);
+        }
+    }
+    for (auto it = refreshJobs.cbegin(); it != refreshJobs.cend(); ++it)
+    {
+        res.insert(it.value(), static_cast<OrnPkTransaction *>(it.key()));
+    }
+    for (const auto &alias : refreshBulkRepos)
+    {
+        res.insert(alias, static_cast<OrnPkTransaction *>(refreshBulkJob));
+    }
+    return res;
+}
+
+void OrnPmPrivate::logTransaction(OrnPkTransaction *transaction, quint32 exit, quint32 runtime)
+{
+    auto record = transaction->summary(exit, runtime);
+    QStringList items;
+    for (const auto &id : transactionHash.value(transaction))
+    {
+        items << Orn::packageName(id);
+    }
+    if (refreshJobs.contains(transaction))
+    {
+        items << refreshJobs.value(transaction);
+    }
+    else if (transaction == refreshBulkJob)
+    {
+        items << refreshBulkRepos;
+    }
+    record.insert(QStringLiteral("items"), items);
+    record.insert(QStringLiteral("finished"), QDateTime::currentDateTime());
+    qDebug() << "Transaction" << transaction << "summary:" << record;
+
+    transactionLog << record;
+    while (transactionLog.size() > PK_TRANSACTION_LOG_SIZE)
+    {
+        transactionLog.removeFirst();
+    }
+}
+
+/*!
+    Creates a spare transaction for the next transaction() call.
+    Call only when more jobs are queued, an unused spare expires soon.
+ */
+void OrnPmPrivate::prefetchTransaction()
+{
+    if (pkPrefetching || !pkSparePath.isEmpty())
+    {
+        return;
+    }
+
+    pkPrefetching = true;
+    auto message = QDBusMessage::createMethodCall(
+                PK_SERVICE, PK_PATH, PK_SERVICE, QStringLiteral("CreateTransaction"));
+    auto watcher = new QDBusPendingCallWatcher(
+                QDBusConnection::systemBus().asyncCall(message), q_ptr);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [this, watcher]()
+    {
+        QDBusPendingReply<QDBusObjectPath> reply(*watcher);
+        pkPrefetching = false;
+        if (!reply.isError())
+        {
+            pkSparePath = reply.value().path();
+            pkSpareTimer.start();
+        }
+        watcher->deleteLater();
+    });
+}
+
+#ifdef QT_DEBUG
+void OrnPm::onTransactionFinished(quint32 exit, quint32 runtime)
+{
+    qDebug() << this->sender()
+             << (exit == Transaction::ExitSuccess ? "finished in" : "failed after")
+             << runtime << "msec";
+    this->sender()->deleteLater();
+}
+
+void OrnPm::emitError(quint32 code, const QString& details)
+{
+    qDebug() << this->sender() << "error code" << code << "-" << details;
+    emit this->error(code, details);
+}
+#endif
+
+/*!
+    Computes updates from the solv files at first and then confirms them with PackageKit.
+    The local estimate is skipped once PackageKit has returned updates, so they do not
+    change twice on each check.
+ */
+void OrnPm::getUpdates()
+{
+    // Check once again when the running check is finished
+    if (d_ptr->updatesRunning)
+    {
+        d_ptr->updatesPending = true;
+        return;
+    }
+    d_ptr->updatesRunning = true;
+    if (d_ptr->updatesConfirmed)
+    {
+        this->getPkUpdates();
+    }
+    else
+    {
+        d_ptr->estimateUpdates(true);
+    }
+}
+
+/*!
+    Computes updates in a worker thread. If \a confirm is true the result
+    is checked with PackageKit afterwards. Otherwise the result is dropped
+    if a PackageKit check is running or was started meanwhile.
+ */
+void OrnPmPrivate::estimateUpdates(bool confirm)
+{
+    auto generation = updatesGeneration;
+    auto watcher = new QFutureWatcher<StringHash>(q_ptr);
+    QObject::connect(watcher, &QFutureWatcher<StringHash>::finished,
+                     [this, watcher, confirm, generation]()
+    {
+        watcher->deleteLater();
+        if (!confirm && (updatesRunning || generation != updatesGeneration))
+        {
+            qDebug() << "Dropping local updates as PackageKit is checking them";
+            return;
+        }
+        this->applyUpdates(watcher->result());
+        if (confirm)
+        {
+            q_ptr->getPkUpdates();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(this, &OrnPmPrivate::computeUpdates, state));
+}
+
+void OrnPm::getPkUpdates()
+{
+    ++d_ptr->updatesGeneration;
+    if (NetworkManager::instance()->state() != QLatin1String("online"))
+    {
+        qWarning("Network is unavailable!");
+        this->onGetUpdatesFinished(Transaction::ExitFailed, 0);
+        return;
+    }
+    auto t = d_ptr->transaction();
+    connect(t, SIGNAL(Package(quint32,QString,QString)), this, SLOT(onPackageUpdate(quint32,QString,QString)));
+    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(onGetUpdatesFinished(quint32,quint32)));
+    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_GETUPDATES "(" << PK_FLAG_NONE << ")";
+    t->asyncCall(QStringLiteral(PK_METHOD_GETUPDATES), PK_FLAG_NONE);
+}
+
+void OrnPm::onPackageUpdate(quint32 info, const QString& packageId, const QString &summary)
+{
+    Q_UNUSED(summary)
+    Q_ASSERT(info == Transaction::InfoEnhancement);
+    // Filter updates only for ORN packages
+    if (Orn::packageRepo(packageId).startsWith(repoNamePrefix))
+    {
+        d_ptr->newUpdatablePackages.insert(Orn::packageName(packageId), packageId);
+    }
+}
+
+void OrnPm::onGetUpdatesFinished(quint32 status, quint32 runtime)
+{
+    Q_UNUSED(runtime)
+    if (status == Transaction::ExitSuccess)
+    {
+        OrnPmPrivate::StringHash updatable;
+        updatable.swap(d_ptr->newUpdatablePackages);
+        d_ptr->applyUpdates(updatable);
+        d_ptr->updatesConfirmed = true;
+        d_ptr->saveSnapshot();
+    }
+    d_ptr->newUpdatablePackages.clear();
+    d_ptr->updatesRunning = false;
+    if (d_ptr->updatesPending)
+    {
+        d_ptr->updatesPending = false;
+        this->getUpdates();
+    }
+}
+
+/*!
+    Finds ORN packages which have newer versions than the installed ones
+    comparing their EVRs in the solv pool.
+ */
+OrnPmPrivate::StringHash OrnPmPrivate::computeUpdates(const StatePtr &current)
+{
+    StringHash updatable;
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutexLocker locker(&solvMutex);
+    this->updateSolvIndex(*current);
+    auto installed = solvPool->installed;
+    if (!installed)
+    {
+        return updatable;
+    }
+
+    QString idTmpl(QStringLiteral("%1;%2;%3;%4"));
+    Id p;
+    Solvable *s;
+    FOR_REPO_SOLVABLES(installed, p, s)
+    {
+        auto it = solvNameIndex.constFind(s->name);
+        if (it == solvNameIndex.cend())
+        {
+            continue;
+        }
+        // All the other repos in the pool are ORN ones
+        Solvable *best = s;
+        for (const auto &cp : it.value())
+        {
+            auto c = pool_id2solvable(solvPool, cp);
+            if (c->repo != installed && solvArchs.contains(c->arch) &&
+                pool_evrcmp(solvPool, c->evr, best->evr, EVRCMP_COMPARE) > 0)
+            {
+                best = c;
+            }
+        }
+        if (best != s)
+        {
+            auto name = QString::fromUtf8(pool_id2str(solvPool, s->name));
+            updatable.insert(name, idTmpl.arg(name,
+                                              QString::fromUtf8(pool_id2str(solvPool, best->evr)),
+                                              QString::fromUtf8(pool_id2str(solvPool, best->arch)),
+                                              QString::fromUtf8(best->repo->name)));
+        }
+    }
+    locker.unlock();
+
+    qDebug() << "Found" << updatable.size() << "updates in solv data in"
+             << timer.elapsed() << "msec";
+    return updatable;
+}
+
+/*!
+    Publishes the \a updatable packages and notifies about the changes.
+    Updates from removed and disabled repos are skipped.
+ */
+void OrnPmPrivate::applyUpdates(StringHash updatable)
+{
+    auto newState = this->copyState();
+    auto it = updatable.begin();
+    while (it != updatable.end())
+    {
+        // A walkaround to skip inactual updates from removed/disabled repos
+        if (!newState->repos.value(Orn::packageRepo(it.value()), false))
+        {
+            it = updatable.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    auto diff = OrnPmPrivate::diffUpdates(state->updatable, updatable);
+    if (diff.isEmpty())
+    {
+        return;
+    }
+
+    // If some client listen to packageStatusChanged() and want to take a package
+    // update ID the new state is published before the notifications
+    newState->updatable = updatable;
+    this->publishState(newState);
+    for (const auto &name : diff.added + diff.changed)
+    {
+        emit q_ptr->packageStatusChanged(name, OrnPm::PackageUpdateAvailable);
+    }
+    for (const auto &name : diff.removed)
+    {
+        emit q_ptr->packageStatusChanged(name, q_ptr->packageStatus(name));
+    }
+    this->emitUpdatesDiff(diff);
+}
+
+/*!
+    Returns the difference between the updatable packages \a before and \a after.
+ */
+OrnPmPrivate::UpdatesDiff OrnPmPrivate::diffUpdates(const StringHash &before, const StringHash &after)
+{
+    UpdatesDiff diff;
+    for (auto it = after.cbegin(); it != after.cend(); ++it)
+    {
+        auto bit = before.find(it.key());
+        if (bit == before.cend())
+        {
+            diff.added << it.key();
+        }
+        else if (bit.value() != it.value())
+        {
+            diff.changed << it.key();
+        }
+    }
+    for (auto it = before.cbegin(); it != before.cend(); ++it)
+    {
+        if (!after.contains(it.key()))
+        {
+            diff.removed << it.key();
+        }
+    }
+    return diff;
+}
+
+void OrnPmPrivate::emitUpdatesDiff(const UpdatesDiff &diff)
+{
+    if (diff.isEmpty())
+    {
+        return;
+    }
+    qDebug() << "Updates:" << diff.added.size() << "added," << diff.removed.size()
+             << "removed," << diff.changed.size() << "changed";
+    emit q_ptr->updatablePackagesDiff(diff.added, diff.removed, diff.changed);
+    emit q_ptr->updatablePackagesChanged();
+}
+
+void OrnPm::getPackageVersions(const QString &packageName)
+{
+    Q_ASSERT(!packageName.isEmpty());
+    CHECK_INITIALISED();
+
+    // Requests are collected for a short time and then resolved with a single job
+    d_ptr->versionsRequested.insert(packageName);
+    if (!d_ptr->versionsTimer->isActive())
+    {
+        d_ptr->versionsTimer->start();
+    }
+}
+
+void OrnPm::resolvePackageVersions()
+{
+    QStringList names;
+    auto it = d_ptr->versionsRequested.begin();
+    while (it != d_ptr->versionsRequested.end())
+    {
+        // A package that is being resolved now could have changed its state
+        // after the job has started so wait for it and resolve once again
+        if (d_ptr->versionsInFlight.contains(*it))
+        {
+            ++it;
+        }
+        else
+        {
+            names << *it;
+            d_ptr->versionsInFlight.insert(*it);
+            it = d_ptr->versionsRequested.erase(it);
+        }
+    }
+
+    if (names.isEmpty())
+    {
+        return;
+    }
+
+    qDebug() << "Resolving package versions for" << names;
+    auto watcher = new QFutureWatcher<OrnPackageVersionHash>(this);
+    connect(watcher, &QFutureWatcher<OrnPackageVersionHash>::finished, [this, watcher]()
+    {
+        auto res = watcher->result();
+        for (auto it = res.cbegin(); it != res.cend(); ++it)
+        {
+            d_ptr->versionsInFlight.remove(it.key());
+            emit this->packageVersions(it.key(), it.value());
+        }
+        watcher->deleteLater();
+        if (!d_ptr->versionsRequested.isEmpty() && !d_ptr->versionsTimer->isActive())
+        {
+            d_ptr->versionsTimer->start();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(d_ptr, &OrnPmPrivate::preparePackageVersions,
+                                         names, d_ptr->state));
+}
+
+/*!
+    Resolves versions of all the \a packageNames in a single pass over the solv
+    data and emits them with one \l OrnPm::packageVersionsBatch() signal.
+ */
+void OrnPm::getPackageVersionsBatch(const QStringList &packageNames)
+{
+    Q_ASSERT(!packageNames.isEmpty());
+    CHECK_INITIALISED();
+    qDebug() << "Resolving package versions for" << packageNames.size() << "packages";
+
+    auto current = d_ptr->state;
+    QtConcurrent::run([this, packageNames, current]()
+    {
+        emit this->packageVersionsBatch(d_ptr->preparePackageVersions(packageNames, current));
+    });
+}
+
+OrnPackageVersionHash OrnPmPrivate::preparePackageVersions(const QStringList &packageNames,
+                                                           const StatePtr &current)
+{
+    OrnPackageVersionHash res;
+    QLatin1String installedAlias("installed");
+
+    QMutexLocker locker(&solvMutex);
+    this->updateSolvIndex(*current);
+
+    for (const auto &packageName : packageNames)
+    {
+        auto &versions = res[packageName];
+        // The name is not in the string pool so there are no such packages
+        auto nameId = pool_str2id(solvPool, packageName.toUtf8().constData(), 0);
+        bool seekInstalled = true;
+        for (const auto &p : solvNameIndex.value(nameId))
+        {
+            auto s = pool_id2solvable(solvPool, p);
+            if (s->repo == solvPool->installed)
+            {
+                if (seekInstalled)
+                {
+                    versions << OrnPackageVersion(
+                                    0,
+                                    solvable_lookup_num(s, SOLVABLE_INSTALLSIZE, 0),
+                                    pool_id2str(solvPool, s->evr),
+                                    pool_id2str(solvPool, s->arch),
+                                    installedAlias);
+                    seekInstalled = false;
+                }
+                continue;
+            }
+            // Only the matching solvables are converted to strings
+            if (solvArchs.contains(s->arch))
+            {
+                versions << OrnPackageVersion(
+                                solvable_lookup_num(s, SOLVABLE_DOWNLOADSIZE, 0),
+                                solvable_lookup_num(s, SOLVABLE_INSTALLSIZE, 0),
+                                pool_id2str(solvPool, s->evr),
+                                pool_id2str(solvPool, s->arch),
+                                s->repo->name);
+            }
+        }
+    }
+    locker.unlock();
+
+    for (auto it = res.begin(); it != res.end(); ++it)
+    {
+        std::sort(it->rbegin(), it->rend());
+    }
+
+    qDebug() << "Finished resolving versions for" << res.size() << "packages";
+    return res;
+}
+
+/*!
+    Queues the packages with the \a packageIds to be processed with the \a operation.
+    Packages which are waiting in the queue are moved to the new job, the queued
+    jobs of the same operation are merged to be run in a single transaction.
+ */
+void OrnPmPrivate::queuePackageJob(OrnPm::Operation operation, const QStringList &packageIds,
+                                   bool autoremove)
+{
+    QStringList ids;
+    auto running = transactionHash.value(packageJob);
+    for (const auto &id : packageIds)
+    {
+        auto name = Orn::packageName(id);
+        if (operations.contains(name))
+        {
+            auto isName = [&name](const QString &other)
+            {
+                return Orn::packageName(other) == name;
+            };
+            if (std::any_of(running.cbegin(), running.cend(), isName))
+            {
+                qWarning() << name << "is already being processed!";
+                continue;
+            }
+            auto jit = packageJobs.begin();
+            while (jit != packageJobs.end())
+            {
+                auto &queued = jit->ids;
+                queued.erase(std::remove_if(queued.begin(), queued.end(), isName), queued.end());
+                jit = queued.isEmpty() ? packageJobs.erase(jit) : jit + 1;
+            }
+        }
+        operations.insert(name, operation);
+        ids << id;
+    }
+    if (ids.isEmpty())
+    {
+        return;
+    }
+
+    auto jit = std::find_if(packageJobs.begin(), packageJobs.end(),
+                            [operation, autoremove](const PackageJob &job)
+    {
+        return job.operation == operation && job.autoremove == autoremove;
+    });
+    if (jit != packageJobs.end())
+    {
+        qDebug() << "Merging" << ids << "with a queued job";
+        jit->ids << ids;
+    }
+    else
+    {
+        packageJobs << PackageJob{ operation, ids, autoremove };
+    }
+
+    emit q_ptr->operationsChanged();
+    emit q_ptr->queueChanged();
+    for (const auto &id : ids)
+    {
+        auto name = Orn::packageName(id);
+        emit q_ptr->packageStatusChanged(name, q_ptr->packageStatus(name));
+    }
+    this->runPackageJob();
+}
+
+/*!
+    Starts a transaction for the first queued package job if no other is running.
+ */
+void OrnPmPrivate::runPackageJob()
+{
+    if (packageJob || packageJobs.isEmpty())
+    {
+        // The queued job will need a transaction when the running one is finished
+        if (!packageJobs.isEmpty())
+        {
+            this->prefetchTransaction();
+        }
+        return;
+    }
+
+    auto job = packageJobs.takeFirst();
+    auto t = this->transaction(job.ids);
+    packageJob = t;
+    QObject::connect(t, SIGNAL(Package(quint32,QString,QString)),
+                     q_ptr, SLOT(onJobPackage(quint32,QString,QString)));
+    switch (job.operation)
+    {
+    case OrnPm::InstallingPackage:
+        QObject::connect(t, SIGNAL(Finished(quint32,quint32)), q_ptr, SLOT(onPackageInstalled(quint32,quint32)));
+        qDebug().nospace() << "Calling " << t << "->" PK_METHOD_INSTALLPACKAGES "("
+                           << PK_FLAG_NONE << ", " << job.ids << ")";
+        t->asyncCall(QStringLiteral(PK_METHOD_INSTALLPACKAGES), PK_FLAG_NONE, job.ids);
+        break;
+    case OrnPm::RemovingPackage:
+        QObject::connect(t, SIGNAL(Finished(quint32,quint32)), q_ptr, SLOT(onPackageRemoved(quint32,quint32)));
+        qDebug().nospace() << "Calling " << t << "->" PK_METHOD_REMOVEPACKAGES "("
+                           << PK_FLAG_NONE << ", " << job.ids << ", false, " << job.autoremove << ")";
+        t->asyncCall(QStringLiteral(PK_METHOD_REMOVEPACKAGES), PK_FLAG_NONE, job.ids,
+                     false, job.autoremove);
+        break;
+    case OrnPm::UpdatingPackage:
+        QObject::connect(t, SIGNAL(Finished(quint32,quint32)), q_ptr, SLOT(onPackageUpdated(quint32,quint32)));
+        qDebug().nospace() << "Calling " << t << "->" PK_METHOD_UPDATEPACKAGES "("
+                           << PK_FLAG_NONE << ", " << job.ids << ")";
+        t->asyncCall(QStringLiteral(PK_METHOD_UPDATEPACKAGES), PK_FLAG_NONE, job.ids);
+        break;
+    default:
+        Q_UNREACHABLE();
+    }
+
+    // Long jobs keep reporting progress, a silent one is cancelled and finished
+    // locally so the following jobs and the repo refreshes are not blocked.
+    // The timer is deleted with the transaction.
+    auto watchdog = new QTimer(t);
+    watchdog->setSingleShot(true);
+    watchdog->setInterval(PACKAGE_JOB_TIMEOUT);
+    QObject::connect(t, SIGNAL(progressChanged()), watchdog, SLOT(start()));
+    QObject::connect(t, SIGNAL(Package(quint32,QString,QString)), watchdog, SLOT(start()));
+    QObject::connect(watchdog, &QTimer::timeout, [t]()
+    {
+        qWarning() << "Package job" << t << "has no progress, cancelling";
+        t->asyncCall(QStringLiteral("Cancel"));
+        t->fail(QStringLiteral("Package job timed out"));
+    });
+    watchdog->start();
+
+    if (!packageJobs.isEmpty())
+    {
+        this->prefetchTransaction();
+    }
+    emit q_ptr->queueChanged();
+}
+
+bool OrnPmPrivate::hasPackageJobs() const
+{
+    return packageJob || !packageJobs.isEmpty();
+}
+
+/*!
+    Returns the ids of packages processed by the \a transaction and removes
+    their operations. It is called for failed transactions too, so the next
+    package job is always started.
+ */
+QStringList OrnPmPrivate::finishPackageOperations(QObject *transaction)
+{
+    auto ids = transactionHash.take(transaction);
+    for (const auto &id : ids)
+    {
+        operations.remove(Orn::packageName(id));
+    }
+    emit q_ptr->operationsChanged();
+
+    // Run the next package job or let the repo refreshes continue
+    if (transaction == packageJob)
+    {
+        packageJob = nullptr;
+        emit q_ptr->queueChanged();
+        this->runPackageJob();
+        q_ptr->refreshNextRepo();
+    }
+    return ids;
+}
+
+/*!
+    Publishes the state changed by the successful \a operation on the packages
+    with the \a ids and emits their signals.
+ */
+void OrnPmPrivate::applyPackageResults(OrnPm::Operation operation, const QStringList &ids)
+{
+    if (ids.isEmpty())
+    {
+        return;
+    }
+
+    auto newState = this->copyState();
+    for (const auto &id : ids)
+    {
+        if (operation == OrnPm::RemovingPackage)
+        {
+            newState->installed.remove(Orn::packageName(id));
+            continue;
+        }
+        if (operation == OrnPm::UpdatingPackage)
+        {
+            newState->updatable.remove(Orn::packageName(id));
+        }
+        newState->installed.insert(id);
+    }
+    auto diff = OrnPmPrivate::diffUpdates(state->updatable, newState->updatable);
+    this->publishState(newState);
+    for (const auto &id : ids)
+    {
+        auto name = Orn::packageName(id);
+        switch (operation)
+        {
+        case OrnPm::InstallingPackage:
+            emit q_ptr->packageInstalled(name);
+            emit q_ptr->packageStatusChanged(name, OrnPm::PackageInstalled);
+            break;
+        case OrnPm::RemovingPackage:
+            emit q_ptr->packageRemoved(name);
+            emit q_ptr->packageStatusChanged(name, OrnPm::PackageNotInstalled);
+            break;
+        case OrnPm::UpdatingPackage:
+            emit q_ptr->packageUpdated(name);
+            emit q_ptr->packageStatusChanged(name, OrnPm::PackageInstalled);
+            break;
+        default:
+            Q_UNREACHABLE();
+        }
+    }
+    this->emitUpdatesDiff(diff);
+}
+
+/*!
+    Finishes a package of the running job as soon as PackageKit reports it,
+    so the packages of a batch change their statuses one by one.
+ */
+void OrnPm::onJobPackage(quint32 info, const QString &packageId, const QString &summary)
+{
+    Q_UNUSED(summary)
+    auto t = this->sender();
+    if (info != Transaction::InfoFinished || t != d_ptr->packageJob)
+    {
+        return;
+    }
+
+    // Dependencies are reported too, handle only the requested packages
+    auto name = Orn::packageName(packageId);
+    auto &ids = d_ptr->transactionHash[t];
+    auto it = std::find_if(ids.begin(), ids.end(), [&name](const QString &id)
+    {
+        return Orn::packageName(id) == name;
+    });
+    if (it == ids.end())
+    {
+        return;
+    }
+
+    auto id = *it;
+    ids.erase(it);
+    auto operation = d_ptr->operations.take(name);
+    emit this->operationsChanged();
+    emit this->queueChanged();
+    d_ptr->applyPackageResults(operation, QStringList(id));
+}
+
+void OrnPm::installPackage(const QString &packageId)
+{
+    this->installPackages(QStringList(packageId));
+}
+
+/*!
+    Installs all the packages with the \a packageIds in a single transaction.
+ */
+void OrnPm::installPackages(const QStringList &packageIds)
+{
+    CHECK_NETWORK();
+    CHECK_INITIALISED();
+    d_ptr->queuePackageJob(InstallingPackage, packageIds);
+}
+
+void OrnPm::installFile(const QString &packageFile)
+{
+    CHECK_NETWORK();
+
+    auto t = d_ptr->transaction();
+    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(onPackageInstalled(quint32,quint32)));
+    QStringList files(packageFile);
+    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_INSTALLFILES "(" << PK_FLAG_NONE << ", " << files << ")";
+    t->asyncCall(QStringLiteral(PK_METHOD_INSTALLFILES), PK_FLAG_NONE, files);
+}
+
+void OrnPm::onPackageInstalled(quint32 exit, quint32 runtime)
+{
+    Q_UNUSED(runtime)
+    auto ids = d_ptr->finishPackageOperations(this->sender());
+    if (exit == Transaction::ExitSuccess)
+    {
+        d_ptr->applyPackageResults(InstallingPackage, ids);
+    }
+    else
+    {
+        for (const auto &id : ids)
+        {
+            emit this->packageStatusChanged(Orn::packageName(id), OrnPm::PackageUnknownStatus);
+        }
     }
 }
 
 void OrnPm::removePackage(const QString &packageId, bool autoremove)
 {
-    SET_OPERATION_ITEM(RemovingPackage, Orn::packageName(packageId));
+    this->removePackages(QStringList(packageId), autoremove);
+}
 
-    auto t = d_ptr->transaction(packageId);
-    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(onPackageRemoved(quint32,quint32)));
-    QStringList ids(packageId);
-    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_REMOVEPACKAGES "("
-                       << PK_FLAG_NONE << ", " << ids << ", false, " << autoremove << ")";
-    emit this->packageStatusChanged(Orn::packageName(packageId), OrnPm::PackageRemoving);
-    t->asyncCall(QStringLiteral(PK_METHOD_REMOVEPACKAGES), PK_FLAG_NONE, ids, false, autoremove);
+/*!
+    Removes all the packages with the \a packageIds in a single transaction.
+ */
+void OrnPm::removePackages(const QStringList &packageIds, bool autoremove)
+{
+    CHECK_INITIALISED();
+    d_ptr->queuePackageJob(RemovingPackage, packageIds, autoremove);
 }
 
 void OrnPm::onPackageRemoved(quint32 exit, quint32 runtime)
 {    
     Q_UNUSED(runtime)
-    auto id = d_ptr->transactionHash.take(this->sender());
-    auto name = Orn::packageName(id);
-    d_ptr->operations.remove(name);
-    emit this->operationsChanged();
+    auto ids = d_ptr->finishPackageOperations(this->sender());
     if (exit == Transaction::ExitSuccess)
     {
-        d_ptr->installedPackages.remove(name);
-        emit this->packageRemoved(name);
-        emit this->packageStatusChanged(name, OrnPm::PackageNotInstalled);
+        d_ptr->applyPackageResults(RemovingPackage, ids);
     }
     else
     {
-        emit this->packageStatusChanged(name, OrnPm::PackageUnknownStatus);
+        for (const auto &id : ids)
+        {
+            emit this->packageStatusChanged(Orn::packageName(id), OrnPm::PackageUnknownStatus);
+        }
+    }
+}
+
+void OrnPm::updatePackage(const QString &packageName)
+{
+    this->updatePackages(QStringList(packageName));
+}
+
+/*!
+    Updates all the packages with the \a packageNames in a single transaction.
+ */
+void OrnPm::updatePackages(const QStringList &packageNames)
+{
+    QStringList packageIds;
+    const auto &updatable = d_ptr->state->updatable;
+    for (const auto &name : packageNames)
+    {
+        auto id = updatable.value(name);
+        if (id.isEmpty())
+        {
+            qWarning() << "The package" << name << "has no updates!";
+        }
+        else
+        {
+            packageIds << id;
+        }
     }
-}
-
-void OrnPm::updatePackage(const QString &packageName)
-{
-    if (!d_ptr->updatablePackages.contains(packageName))
+    if (packageIds.isEmpty())
     {
-        qWarning() << "The package" << packageName << "has no updates!";
         return;
     }
     CHECK_NETWORK();
-    SET_OPERATION_ITEM(UpdatingPackage, packageName);
+    CHECK_INITIALISED();
+    d_ptr->queuePackageJob(UpdatingPackage, packageIds);
+}
 
-    auto packageId = d_ptr->updatablePackages[packageName];
-    auto t = d_ptr->transaction(packageId);
-    connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(onPackageUpdated(quint32,quint32)));
-    QStringList ids(packageId);
-    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_UPDATEPACKAGES "(" << PK_FLAG_NONE << ", " << ids << ")";
-    emit this->packageStatusChanged(packageName, OrnPm::PackageUpdating);
-    t->asyncCall(QStringLiteral(PK_METHOD_UPDATEPACKAGES), PK_FLAG_NONE, ids);
+/*!
+    Updates all the updatable ORN packages in a single transaction.
+ */
+void OrnPm::updateAll()
+{
+    this->updatePackages(d_ptr->state->updatable.keys());
 }
 
 void OrnPm::onPackageUpdated(quint32 exit, quint32 runtime)
 {
     Q_UNUSED(runtime)
-    auto id = d_ptr->transactionHash.take(this->sender());
-    auto name = Orn::packageName(id);
-    d_ptr->operations.remove(name);
-    emit this->operationsChanged();
+    auto ids = d_ptr->finishPackageOperations(this->sender());
     if (exit == Transaction::ExitSuccess)
     {
-        d_ptr->updatablePackages.remove(name);
-        d_ptr->installedPackages[name] = id;
-        emit this->packageUpdated(name);
-        emit this->packageStatusChanged(name, OrnPm::PackageInstalled);
-        emit this->updatablePackagesChanged();
+        d_ptr->applyPackageResults(UpdatingPackage, ids);
     }
     else
     {
-        emit this->packageStatusChanged(name, OrnPm::PackageUnknownStatus);
+        for (const auto &id : ids)
+        {
+            emit this->packageStatusChanged(Orn::packageName(id), OrnPm::PackageUnknownStatus);
+        }
     }
 }
 
@@ -574,76 +1831,121 @@ void OrnPm::modifyRepo(const QString &repoAlias, const OrnPm::RepoAction &action
 void OrnPm::enableRepos(bool enable)
 {
     CHECK_INITIALISED();
-
-    QtConcurrent::run(d_ptr, &OrnPmPrivate::enableRepos, enable);
-}
-
-void OrnPm::removeAllRepos()
-{
-    QtConcurrent::run(d_ptr, &OrnPmPrivate::removeAllRepos);
-}
-
-void OrnPmPrivate::enableRepos(bool enable)
-{
     CHECK_NETWORK();
+
     qDebug() << (enable ? "Enabling" : "Disabling") << "all repositories";
-    QString method(QStringLiteral(SSU_METHOD_MODIFYREPO));
+    auto action = enable ? EnableRepo : DisableRepo;
+    QStringList aliases;
+    QList<QVariantList> calls;
+    const auto &repos = d_ptr->state->repos;
+    for (auto it = repos.cbegin(); it != repos.cend(); ++it)
+    {
+        if (it.value() != enable)
+        {
+            aliases << it.key();
+            calls << QVariantList{ action, it.key() };
+        }
+    }
 
-    if (enable)
+    d_ptr->callSsuBatch(QStringLiteral(SSU_METHOD_MODIFYREPO), calls,
+                        [this, enable, aliases](int failed)
     {
-        bool needRefresh = false;
-        for (auto it = repos.begin(); it != repos.end(); ++it)
+        // Repos could be changed while waiting for ssu replies
+        auto newState = d_ptr->copyState();
+        for (const auto &alias : aliases)
         {
-            if (!it.value())
+            auto it = newState->repos.find(alias);
+            if (it != newState->repos.end())
             {
-                ssuInterface->call(method, OrnPm::EnableRepo, it.key());
-                *it = true;
-                needRefresh = true;
+                *it = enable;
             }
         }
-        if (needRefresh)
+        if (!enable)
         {
-            q_ptr->refreshRepos();
+            newState->updatable.clear();
         }
-    }
-    else
-    {
-        for (auto it = repos.begin(); it != repos.end(); ++it)
+        auto diff = OrnPmPrivate::diffUpdates(d_ptr->state->updatable, newState->updatable);
+        d_ptr->publishState(newState);
+
+        qDebug() << "Finished" << (enable ? "enabling" : "disabling") << aliases.size()
+                 << "repositories with" << failed << "errors";
+        if (enable && !aliases.isEmpty())
         {
-            if (it.value())
-            {
-                ssuInterface->call(method, OrnPm::DisableRepo, it.key());
-                *it = false;
-            }
+            this->refreshRepos();
         }
-        updatablePackages.clear();
-        emit q_ptr->updatablePackagesChanged();
+        d_ptr->emitUpdatesDiff(diff);
+        emit this->enableReposFinished();
+    });
+}
+
+void OrnPm::removeAllRepos()
+{
+    qDebug() << "Removing all repositories";
+    QList<QVariantList> calls;
+    const auto &repos = d_ptr->state->repos;
+    for (auto it = repos.cbegin(); it != repos.cend(); ++it)
+    {
+        calls << QVariantList{ RemoveRepo, it.key() };
     }
 
-    qDebug() << "Finished" << (enable ? "enabling" : "disabling") << "all repositories";
-    emit q_ptr->enableReposFinished();
+    d_ptr->callSsuBatch(QStringLiteral(SSU_METHOD_MODIFYREPO), calls, [this](int failed)
+    {
+        auto newState = d_ptr->copyState();
+        newState->repos.clear();
+        newState->updatable.clear();
+        auto diff = OrnPmPrivate::diffUpdates(d_ptr->state->updatable, newState->updatable);
+        d_ptr->publishState(newState);
+
+        qDebug() << "Finished removing all repositories with" << failed << "errors";
+        d_ptr->emitUpdatesDiff(diff);
+        emit this->removeAllReposFinished();
+    });
 }
 
-void OrnPmPrivate::removeAllRepos()
+/*!
+    Calls the ssu \a method with each of the argument lists in \a calls without
+    waiting for replies and calls \a finished with the number of failed calls
+    when all the replies are received.
+ */
+void OrnPmPrivate::callSsuBatch(const QString &method, const QList<QVariantList> &calls,
+                                const std::function<void(int)> &finished)
 {
-    qDebug() <<"Removing all repositories";
-    QString method(QStringLiteral(SSU_METHOD_MODIFYREPO));
-
-    for (auto it = repos.begin(); it != repos.end(); ++it)
+    if (calls.isEmpty())
     {
-        ssuInterface->call(method, OrnPm::RemoveRepo, it.key());
+        finished(0);
+        return;
     }
-    repos.clear();
-    updatablePackages.clear();
-    emit q_ptr->updatablePackagesChanged();
 
-    qDebug() << "Finished removing all repositories";
-    emit q_ptr->removeAllReposFinished();
+    qDebug().nospace() << "Calling " << ssuInterface << "->" << method
+                       << "() " << calls.size() << " times";
+    QSharedPointer<int> pending(new int(calls.size()));
+    QSharedPointer<int> failed(new int(0));
+    for (const auto &args : calls)
+    {
+        auto watcher = new QDBusPendingCallWatcher(
+                    ssuInterface->asyncCallWithArgumentList(method, args), q_ptr);
+        QObject::connect(watcher, &QDBusPendingCallWatcher::finished,
+                         [watcher, method, args, pending, failed, finished]()
+        {
+            if (watcher->isError())
+            {
+                qWarning() << "Calling" << method << args << "failed:" << watcher->error().message();
+                ++*failed;
+            }
+            watcher->deleteLater();
+            if (--*pending == 0)
+            {
+                finished(*failed);
+            }
+        });
+    }
 }
 
 void OrnPmPrivate::onRepoModified(const QString &repoAlias, const OrnPm::RepoAction &action)
 {
     bool needRefresh = false;
+    auto newState = this->copyState();
+    auto &repos = newState->repos;
 
     switch (action)
     {
@@ -662,6 +1964,7 @@ void OrnPmPrivate::onRepoModified(const QString &repoAlias, const OrnPm::RepoAct
         needRefresh = true;
         break;
     }
+    this->publishState(newState);
 
     if (needRefresh)
     {
@@ -672,7 +1975,7 @@ void OrnPmPrivate::onRepoModified(const QString &repoAlias, const OrnPm::RepoAct
                            << repoAlias << ", \"refresh-now\", false)";
         t->asyncCall(QStringLiteral(PK_METHOD_REPOSETDATA), repoAlias,
                      QStringLiteral("refresh-now"), QStringLiteral("false"));
-        QObject::connect(t, &QDBusInterface::destroyed, [this, repoAlias, action]()
+        QObject::connect(t, &OrnPkTransaction::destroyed, [this, repoAlias, action]()
         {
             operations.remove(repoAlias);
             emit q_ptr->operationsChanged();
@@ -695,7 +1998,7 @@ void OrnPm::refreshRepo(const QString &repoAlias, bool force)
     CHECK_NETWORK();
     SET_OPERATION_ITEM(RefreshingRepo, repoAlias);
     auto t = d_ptr->transaction();
-    connect(t, &QDBusInterface::destroyed, [this, repoAlias]()
+    connect(t, &OrnPkTransaction::destroyed, [this, repoAlias]()
     {
         d_ptr->operations.remove(repoAlias);
         emit this->operationsChanged();
@@ -706,89 +2009,342 @@ void OrnPm::refreshRepo(const QString &repoAlias, bool force)
                  force ? QStringLiteral("true") : QStringLiteral("false"));
 }
 
-void OrnPm::refreshRepos(bool force)
+int OrnPm::refreshJobsLimit() const
 {
-    CHECK_NETWORK();
+    return d_ptr->refreshJobsLimit;
+}
+
+void OrnPm::setRefreshJobsLimit(int limit)
+{
+    limit = qMax(1, limit);
+    if (d_ptr->refreshJobsLimit != limit)
+    {
+        d_ptr->refreshJobsLimit = limit;
+        emit this->refreshJobsLimitChanged();
+        this->refreshNextRepo();
+    }
+}
+
+int OrnPm::refreshTimeout() const
+{
+    return d_ptr->refreshTimeout;
+}
+
+void OrnPm::setRefreshTimeout(int msec)
+{
+    if (d_ptr->refreshTimeout != msec)
+    {
+        d_ptr->refreshTimeout = msec;
+        emit this->refreshTimeoutChanged();
+    }
+}
+
+/*!
+    Returns a part of repos that have been refreshed by \l OrnPm::refreshRepos()
+    or 0 if no repos are being refreshed.
+ */
+qreal OrnPm::refreshProgress() const
+{
+    return d_ptr->refreshTotal ?
+                qreal(d_ptr->refreshFinished) / d_ptr->refreshTotal : 0.0;
+}
 
-    for (auto it = d_ptr->repos.cbegin(); it != d_ptr->repos.cend(); ++it)
+/*!
+    Returns the last refresh plan made by \l OrnPm::refreshRepos() and its timings.
+ */
+QVariantMap OrnPm::refreshPlan() const
+{
+    return d_ptr->refreshPlan;
+}
+
+/*!
+    Refreshes enabled repos which metadata is older than REFRESH_MAX_AGE
+    or all enabled repos if \a force is true. Emits \l OrnPm::refreshReposFinished()
+    when all the repos are refreshed.
+ */
+void OrnPm::refreshRepos(bool force)
+{
+    if (NetworkManager::instance()->state() != QLatin1String("online"))
     {
-        // Refresh only enabled repositories
-        if (it.value())
+        qWarning("Network is unavailable!");
+        if (!d_ptr->refreshTotal)
         {
-            d_ptr->reposToRefresh << it.key();
+            emit this->refreshReposFinished();
         }
+        return;
     }
 
-    if (d_ptr->reposToRefresh.isEmpty())
+    bool bulk = false;
+    auto aliases = d_ptr->planRefresh(force, bulk);
+    if (aliases.isEmpty())
     {
-        qDebug() << "No enabled repositories, skipping";
+        qDebug() << "No repositories need refresh, skipping";
+        if (!d_ptr->refreshTotal)
+        {
+            emit this->refreshReposFinished();
+        }
         return;
     }
 
-    qDebug() << "Starting refresh cache for all ORN repositories";
-
-    d_ptr->pkInterface->blockSignals(true);
-    d_ptr->forceRefresh = force ? QStringLiteral("true") : QStringLiteral("false");
-#ifdef QT_DEBUG
-    d_ptr->refreshRuntime = 0;
-#endif
-    this->refreshNextRepo(Transaction::ExitSuccess, 0);
+    if (!d_ptr->refreshTotal)
+    {
+        qDebug() << "Starting refresh cache for" << aliases.size() << "ORN repositories";
+        d_ptr->pkInterface->blockSignals(true);
+        d_ptr->refreshTimer.start();
+    }
+    d_ptr->refreshTotal += aliases.size();
+    emit this->refreshProgressChanged();
+    emit this->queueChanged();
+    // A bulk refresh is not started while other repos or packages are processed
+    if (bulk && !d_ptr->refreshBulkJob && d_ptr->refreshJobs.isEmpty() &&
+        !d_ptr->hasPackageJobs())
+    {
+        d_ptr->startBulkRefresh(aliases, force);
+    }
+    else
+    {
+        d_ptr->reposToRefresh << aliases;
+        if (force)
+        {
+            d_ptr->reposToForce.unite(aliases.toSet());
+        }
+        this->refreshNextRepo();
+    }
 }
 
-void OrnPm::refreshNextRepo(quint32 exit, quint32 runtime)
+/*!
+    Returns enabled repos which need to be refreshed and sets \a bulk
+    if a single RefreshCache transaction is expected to be faster than
+    refreshing the repos one by one.
+ */
+QStringList OrnPmPrivate::planRefresh(bool force, bool &bulk)
 {
-    Q_UNUSED(exit)
+    QStringList stale;
+    QStringList fresh;
+    QString solvTmpl(SOLV_PATH_TMPL);
+    QString cookieTmpl(RAW_COOKIE_TMPL);
+    auto now = QDateTime::currentDateTime();
 
-#ifdef QT_DEBUG
-    d_ptr->refreshRuntime += runtime;
-#else
-    Q_UNUSED(runtime)
-#endif
+    const auto &repos = state->repos;
+    for (auto it = repos.cbegin(); it != repos.cend(); ++it)
+    {
+        // Skip disabled repos and the ones which are refreshed or modified now
+        const auto &alias = it.key();
+        if (!it.value() || operations.contains(alias) || reposToRefresh.contains(alias))
+        {
+            continue;
+        }
+        if (!force)
+        {
+            QFileInfo solvInfo(solvTmpl.arg(alias));
+            QFileInfo cookieInfo(cookieTmpl.arg(alias));
+            if (solvInfo.isFile())
+            {
+                auto updated = solvInfo.lastModified();
+                if (cookieInfo.isFile() && cookieInfo.lastModified() > updated)
+                {
+                    updated = cookieInfo.lastModified();
+                }
+                if (updated.secsTo(now) < REFRESH_MAX_AGE)
+                {
+                    fresh << alias;
+                    continue;
+                }
+            }
+        }
+        stale << alias;
+    }
+
+    // Repos are refreshed in parallel so the time depends on the number of rounds
+    qint64 reposTime = (stale.size() + refreshJobsLimit - 1) / refreshJobsLimit * refreshRepoTime;
+    bulk = stale.size() > 1 && refreshBulkTime < reposTime;
+
+    refreshPlan = QVariantMap{
+        { QStringLiteral("bulk"),               bulk },
+        { QStringLiteral("stale"),              stale },
+        { QStringLiteral("fresh"),              fresh },
+        { QStringLiteral("estimatedRepoTime"),  reposTime },
+        { QStringLiteral("estimatedBulkTime"),  refreshBulkTime },
+        { QStringLiteral("averageRepoTime"),    refreshRepoTime }
+    };
+    qDebug() << "Refresh plan:" << stale.size() << "stale and" << fresh.size()
+             << "fresh repos, estimated" << (bulk ? refreshBulkTime : reposTime)
+             << "msec with" << (bulk ? "bulk refresh" : "refreshing repos one by one");
+    return stale;
+}
+
+/*!
+    Starts refreshing the queued repos while there are less than
+    \l OrnPm::refreshJobsLimit repos being refreshed.
+ */
+void OrnPm::refreshNextRepo()
+{
+    if (!d_ptr->refreshTotal)
+    {
+        return;
+    }
 
     bool offline = NetworkManager::instance()->state() != QLatin1String("online");
     if (offline)
     {
         d_ptr->reposToRefresh.clear();
+        d_ptr->reposToForce.clear();
+    }
+
+    // Package jobs are started by users so they go before the refreshes
+    while (!d_ptr->reposToRefresh.isEmpty() && !d_ptr->hasPackageJobs() &&
+           d_ptr->refreshJobs.size() < d_ptr->refreshJobsLimit)
+    {
+        d_ptr->startRefreshJob(d_ptr->reposToRefresh.takeFirst());
     }
-    if (d_ptr->reposToRefresh.isEmpty())
+    if (!d_ptr->reposToRefresh.isEmpty())
     {
-#ifdef QT_DEBUG
+        d_ptr->prefetchTransaction();
+    }
+
+    if (d_ptr->refreshJobs.isEmpty() && !d_ptr->refreshBulkJob &&
+        d_ptr->reposToRefresh.isEmpty())
+    {
+        auto elapsed = d_ptr->refreshTimer.elapsed();
         if (offline)
         {
             qWarning("Aborting operation due to network gone offline");
         }
         else
         {
-            qDebug() << "Finished refreshing cache for all ORN repositories in"
-                     << d_ptr->refreshRuntime << "msec";
+            qDebug() << "Finished refreshing cache for" << d_ptr->refreshFinished
+                     << "ORN repositories in" << elapsed << "msec";
         }
-#endif
+        d_ptr->refreshPlan.insert(QStringLiteral("runtime"), elapsed);
+        d_ptr->refreshTotal = 0;
+        d_ptr->refreshFinished = 0;
         d_ptr->pkInterface->blockSignals(false);
+        emit this->refreshProgressChanged();
+        emit this->refreshReposFinished();
     }
-    else
+}
+
+void OrnPmPrivate::startRefreshJob(const QString &alias)
+{
+    auto t = this->transaction();
+    QObject::connect(t, SIGNAL(Finished(quint32,quint32)), q_ptr, SLOT(onRepoRefreshed(quint32,quint32)));
+    refreshJobs.insert(t, alias);
+    operations.insert(alias, OrnPm::RefreshingRepo);
+    emit q_ptr->operationsChanged();
+    emit q_ptr->queueChanged();
+
+    // The timer is stopped if the transaction is finished and deleted.
+    // The job keeps its slot until the cancelled transaction is finished.
+    if (refreshTimeout > 0)
     {
-        auto t = d_ptr->transaction();
-        connect(t, SIGNAL(Finished(quint32,quint32)), this, SLOT(refreshNextRepo(quint32,quint32)));
-        auto alias = d_ptr->reposToRefresh.takeFirst();
-        connect(t, &QDBusInterface::destroyed, [this, alias]()
+        QTimer::singleShot(refreshTimeout, t, [this, t]()
         {
-            d_ptr->operations.remove(alias);
-            emit this->operationsChanged();
+            qWarning() << "Refreshing" << refreshJobs.value(t) << "timed out, cancelling";
+            t->asyncCall(QStringLiteral("Cancel"));
         });
-        d_ptr->operations.insert(alias, RefreshingRepo);
-        emit this->operationsChanged();
-        qDebug().nospace() << "Calling " << t << "->" PK_METHOD_REPOSETDATA "("
-                           << alias << ", \"refresh-now\", " << d_ptr->forceRefresh << ")";
-        t->asyncCall(QStringLiteral(PK_METHOD_REPOSETDATA), alias, QStringLiteral("refresh-now"),
-                     d_ptr->forceRefresh);
     }
+
+    QString force(reposToForce.remove(alias) ? QStringLiteral("true") : QStringLiteral("false"));
+    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_REPOSETDATA "("
+                       << alias << ", \"refresh-now\", " << force << ")";
+    t->asyncCall(QStringLiteral(PK_METHOD_REPOSETDATA), alias, QStringLiteral("refresh-now"),
+                 force);
+}
+
+/*!
+    Refreshes all the system repos with a single RefreshCache transaction
+    with the \a force flag. The \a aliases are marked as being refreshed
+    until it is finished.
+ */
+void OrnPmPrivate::startBulkRefresh(const QStringList &aliases, bool force)
+{
+    auto t = this->transaction();
+    QObject::connect(t, SIGNAL(Finished(quint32,quint32)), q_ptr, SLOT(onRepoRefreshed(quint32,quint32)));
+    refreshBulkJob = t;
+    refreshBulkRepos = aliases;
+    for (const auto &alias : aliases)
+    {
+        operations.insert(alias, OrnPm::RefreshingRepo);
+    }
+    emit q_ptr->operationsChanged();
+    emit q_ptr->queueChanged();
+
+    if (refreshTimeout > 0)
+    {
+        QTimer::singleShot(refreshTimeout, t, [t]()
+        {
+            qWarning() << "Refreshing cache timed out, cancelling";
+            t->asyncCall(QStringLiteral("Cancel"));
+        });
+    }
+
+    qDebug().nospace() << "Calling " << t << "->" PK_METHOD_REFRESHCACHE "(" << force << ")";
+    t->asyncCall(QStringLiteral(PK_METHOD_REFRESHCACHE), force);
+}
+
+void OrnPmPrivate::finishRefreshJob(QObject *transaction)
+{
+    if (transaction == refreshBulkJob)
+    {
+        for (const auto &alias : refreshBulkRepos)
+        {
+            operations.remove(alias);
+        }
+        refreshFinished += refreshBulkRepos.size();
+        refreshBulkJob = nullptr;
+        refreshBulkRepos.clear();
+        emit q_ptr->operationsChanged();
+        emit q_ptr->queueChanged();
+        emit q_ptr->refreshProgressChanged();
+        q_ptr->refreshNextRepo();
+        return;
+    }
+
+    auto alias = refreshJobs.take(transaction);
+    if (alias.isEmpty())
+    {
+        return;
+    }
+
+    operations.remove(alias);
+    ++refreshFinished;
+    emit q_ptr->operationsChanged();
+    emit q_ptr->queueChanged();
+    emit q_ptr->refreshProgressChanged();
+    q_ptr->refreshNextRepo();
+}
+
+void OrnPm::onRepoRefreshed(quint32 exit, quint32 runtime)
+{
+    auto t = this->sender();
+    auto success = exit == Transaction::ExitSuccess;
+    auto bulk = t == d_ptr->refreshBulkJob;
+    if (bulk)
+    {
+        qDebug() << "Cache" << (success ? "was refreshed in" : "failed to refresh after")
+                 << runtime << "msec";
+    }
+    else
+    {
+        qDebug() << "Repo" << d_ptr->refreshJobs.value(t)
+                 << (success ? "was refreshed in" : "failed to refresh after")
+                 << runtime << "msec";
+    }
+    // Update the average times for the planner with the successful refreshes
+    if (success && (bulk || d_ptr->refreshJobs.contains(t)))
+    {
+        auto &average = bulk ? d_ptr->refreshBulkTime : d_ptr->refreshRepoTime;
+        average = (average * 3 + runtime) / 4;
+    }
+    d_ptr->finishRefreshJob(t);
 }
 
 QList<OrnRepo> OrnPm::repoList() const
 {
     OrnRepoList repos;
     auto pos = repoNamePrefix.size();
-    for (auto it = d_ptr->repos.cbegin(); it != d_ptr->repos.cend(); ++it)
+    const auto &current = d_ptr->state->repos;
+    for (auto it = current.cbegin(); it != current.cend(); ++it)
     {
         auto alias = it.key();
         repos << OrnRepo{ it.value(), alias, alias.mid(pos) };
@@ -808,17 +2364,95 @@ void OrnPm::getInstalledPackages(const QString &packageName)
         }
         watcher->deleteLater();
     });
-    watcher->setFuture(QtConcurrent::run(d_ptr, &OrnPmPrivate::prepareInstalledPackages, packageName));
+    watcher->setFuture(QtConcurrent::run(d_ptr, &OrnPmPrivate::prepareInstalledPackages,
+                                         packageName, d_ptr->state));
 }
 
-OrnInstalledPackageList OrnPmPrivate::prepareInstalledPackages(const QString &packageName)
+/*!
+    Reads a pretty name and an icon path of an installed package from its desktop file.
+ */
+struct DesktopFileReader
+{
+    DesktopFileReader()
+        : nameKey(QStringLiteral("Desktop Entry/Name"))
+        , iconKey(QStringLiteral("Desktop Entry/Icon"))
+        , iconPaths({
+            QStringLiteral("/usr/share/icons/hicolor/86x86/apps/%0.png"),
+            QStringLiteral("/usr/share/icons/hicolor/108x108/apps/%0.png"),
+            QStringLiteral("/usr/share/icons/hicolor/128x128/apps/%0.png"),
+            QStringLiteral("/usr/share/icons/hicolor/256x256/apps/%0.png")
+          })
+    {
+        auto trNameKey = QString(nameKey).append("[%0]");
+        auto localeName = QLocale::system().name();
+        localeNameKey = trNameKey.arg(localeName);
+        if (localeName.length() > 2)
+        {
+            langNameKey = trNameKey.arg(localeName.left(2));
+        }
+    }
+
+    void operator()(OrnInstalledPackage &package) const
+    {
+        const auto &name = package.name;
+        auto desktopFile = QStandardPaths::locate(
+                    QStandardPaths::ApplicationsLocation, name + ".desktop");
+        if (desktopFile.isEmpty())
+        {
+            return;
+        }
+
+        qDebug() << "Parsing desktop file" << desktopFile;
+        QSettings desktop(desktopFile, QSettings::IniFormat);
+        desktop.setIniCodec("UTF-8");
+        // Read pretty name
+        if (desktop.contains(localeNameKey))
+        {
+            package.title = desktop.value(localeNameKey).toString();
+        }
+        else if (!langNameKey.isEmpty() && desktop.contains(langNameKey))
+        {
+            package.title = desktop.value(langNameKey).toString();
+        }
+        else if (desktop.contains(nameKey))
+        {
+            package.title = desktop.value(nameKey).toString();
+        }
+        qDebug() << "Using name" << package.title << "for package" << name;
+        // Find icon
+        if (desktop.contains(iconKey))
+        {
+            auto iconName = desktop.value(iconKey).toString();
+            for (const auto &path : iconPaths)
+            {
+                auto iconPath = path.arg(iconName);
+                if (QFileInfo(iconPath).isFile())
+                {
+                    qDebug() << "Using package icon" << iconPath;
+                    package.icon = iconPath;
+                    break;
+                }
+            }
+        }
+    }
+
+    QString nameKey;
+    QString localeNameKey;
+    QString langNameKey;
+    QString iconKey;
+    QStringList iconPaths;
+};
+
+OrnInstalledPackageList OrnPmPrivate::prepareInstalledPackages(const QString &packageName,
+                                                               const StatePtr &current)
 {
+    const auto &installedPackages = current->installed;
     Q_ASSERT_X(packageName.isEmpty() || installedPackages.contains(packageName), Q_FUNC_INFO,
                qPrintable(QString("The provided package \"%0\" is not installed").arg(packageName)));
 
     OrnInstalledPackageList packages;
 
-    if (installedPackages.isEmpty() || repos.isEmpty())
+    if (installedPackages.isEmpty() || current->repos.isEmpty())
     {
         qWarning() << "Installed packages or repositories list is empty";
         emit q_ptr->installedPackages(packages);
@@ -826,128 +2460,58 @@ OrnInstalledPackageList OrnPmPrivate::prepareInstalledPackages(const QString &pa
     }
     qDebug() << "Preparing installed packages list";
 
-    // Prepare vars for parsing desktop files
-    QString nameKey(QStringLiteral("Desktop Entry/Name"));
-    auto trNameKey = QString(nameKey).append("[%0]");
-    auto localeName = QLocale::system().name();
-    auto localeNameKey = trNameKey.arg(localeName);
-    QString langNameKey;
-    if (localeName.length() > 2)
+    // Filter installed packages to show only those from OpenRepos.
+    // Names are compared as pool ids and converted to strings only for matches.
+    StringSet ornPackages;
+    QMutexLocker locker(&solvMutex);
+    this->updateSolvIndex(*current);
+    auto ornNames = this->ornNameIds();
+    if (!packageName.isEmpty())
     {
-        langNameKey = trNameKey.arg(localeName.left(2));
+        if (ornNames.contains(pool_str2id(solvPool, packageName.toUtf8().constData(), 0)))
+        {
+            ornPackages.insert(packageName);
+        }
     }
-    QString iconKey(QStringLiteral("Desktop Entry/Icon"));
-    QStringList iconPaths = {
-        QStringLiteral("/usr/share/icons/hicolor/86x86/apps/%0.png"),
-        QStringLiteral("/usr/share/icons/hicolor/108x108/apps/%0.png"),
-        QStringLiteral("/usr/share/icons/hicolor/128x128/apps/%0.png"),
-        QStringLiteral("/usr/share/icons/hicolor/256x256/apps/%0.png")
-    };
-
-    // Prepare set to filter installed packages to show only those from OpenRepos
-    QString solvTmpl(SOLV_PATH_TMPL);
-    StringSet ornPackages;
-    auto spool = pool_create();
-    for (auto it = repos.cbegin(); it != repos.cend(); ++it)
+    else if (solvPool->installed)
     {
-        if (it.value())
+        Id p;
+        Solvable *s;
+        FOR_REPO_SOLVABLES(solvPool->installed, p, s)
         {
-            const auto alias = it.key();
-            auto spath = solvTmpl.arg(alias);
-            qDebug() << "Reading" << spath;
-            auto srepo = repo_create(spool, alias.toUtf8().data());
-
-            auto sfile = fopen(spath.toUtf8().data(), "r");
-            if (!sfile)
-            {
-                qCritical() << "Could not read" << spath;
-                repo_free(srepo, 0);
-                continue;
-            }
-
-            repo_add_solv(srepo, sfile, 0);
-            for (int i = 0; i < spool->nsolvables; ++i)
+            if (ornNames.contains(s->name))
             {
-                auto s = &spool->solvables[i];
-                ornPackages.insert(solvable_lookup_str(s, SOLVABLE_NAME));
+                ornPackages.insert(pool_id2str(solvPool, s->name));
             }
-            fclose(sfile);
-            repo_free(srepo, 0);
         }
     }
-    pool_free(spool);
+    locker.unlock();
 
-    StringHash installed;
-    if (packageName.isEmpty())
+    for (const auto &name : ornPackages)
     {
-        installed = installedPackages;
-    }
-    else
-    {
-        installed[packageName] = installedPackages[packageName];
-    }
-
-    for (auto it = installed.cbegin(); it != installed.cend(); ++it)
-    {
-        const auto &name = it.key();
-
-        // Actual filtering
-        if (!ornPackages.contains(name))
+        // The package could be removed after the installed repo was loaded
+        auto id = installedPackages.packageId(name);
+        if (id.isEmpty())
         {
             continue;
         }
 
         qDebug() << "Adding installed package" << name;
-
-        auto title = name;
-        QString icon;
-        auto desktopFile = QStandardPaths::locate(
-                    QStandardPaths::ApplicationsLocation, name + ".desktop");
-
-        if (!desktopFile.isEmpty())
-        {
-            qDebug() << "Parsing desktop file" << desktopFile;
-            QSettings desktop(desktopFile, QSettings::IniFormat);
-            desktop.setIniCodec("UTF-8");
-            // Read pretty name
-            if (desktop.contains(localeNameKey))
-            {
-                title = desktop.value(localeNameKey).toString();
-            }
-            else if (!langNameKey.isEmpty() && desktop.contains(langNameKey))
-            {
-                title = desktop.value(langNameKey).toString();
-            }
-            else if (desktop.contains(nameKey))
-            {
-                title = desktop.value(nameKey).toString();
-            }
-            qDebug() << "Using name" << title << "for package" << name;
-            // Find icon
-            if (desktop.contains(iconKey))
-            {
-                auto iconName = desktop.value(iconKey).toString();
-                for (const auto &path : iconPaths)
-                {
-                    auto iconPath = path.arg(iconName);
-                    if (QFileInfo(iconPath).isFile())
-                    {
-                        qDebug() << "Using package icon" << iconPath;
-                        icon = iconPath;
-                        break;
-                    }
-                }
-            }
-        }
-        auto id = it.value();
         packages << OrnInstalledPackage {
-            updatablePackages.contains(name),
+            current->updatable.contains(name),
             id,
             Orn::packageName(id),
-            title,
-            icon
+            name,
+            QString()
         };
     }
 
+    // Desktop files of the packages are independent so parse them in parallel
+    QElapsedTimer timer;
+    timer.start();
+    QtConcurrent::blockingMap(packages, DesktopFileReader());
+    qDebug() << "Desktop files of" << packages.size() << "packages were parsed in"
+             << timer.elapsed() << "msec";
+
     return packages;
 }
@@ -1,13 +1,14 @@
 #ifndef ORNPM_H
 #define ORNPM_H
 
+#include "ornpackageversion.h"
+
 #include <QObject>
 
 #include <Transaction>
 
 class QQmlEngine;
 class QJSEngine;
-class OrnPackageVersion;
 class OrnInstalledPackage;
 class OrnRepo;
 
@@ -22,8 +23,12 @@ class OrnPm : public QObject
 
     Q_PROPERTY(bool initialised READ initialised NOTIFY initialisedChanged)
     Q_PROPERTY(QVariantList operations READ operations NOTIFY operationsChanged)
-    Q_PROPERTY(QString deviceModel READ deviceModel CONSTANT)
+    Q_PROPERTY(QVariantList queue READ queue NOTIFY queueChanged)
+    Q_PROPERTY(QString deviceModel READ deviceModel NOTIFY deviceModelChanged)
     Q_PROPERTY(bool updatesAvailable READ updatesAvailable NOTIFY updatablePackagesChanged)
+    Q_PROPERTY(int refreshJobsLimit READ refreshJobsLimit WRITE setRefreshJobsLimit NOTIFY refreshJobsLimitChanged)
+    Q_PROPERTY(int refreshTimeout READ refreshTimeout WRITE setRefreshTimeout NOTIFY refreshTimeoutChanged)
+    Q_PROPERTY(qreal refreshProgress READ refreshProgress NOTIFY refreshProgressChanged)
 
 public:
 
@@ -94,6 +99,8 @@ public:
 
     bool initialised() const;
     QVariantList operations() const;
+    QVariantList queue() const;
+    Q_INVOKABLE QVariantList transactionLog() const;
 
     QString deviceModel() const;
 
@@ -105,11 +112,15 @@ public:
 
 signals:
     void initialisedChanged();
+    void deviceModelChanged();
     void operationsChanged();
+    void queueChanged();
     void packageStatusChanged(const QString &packageName, const PackageStatus &status);
     void error(quint32 code, const QString &details);
 
 private slots:
+    void onInstalledSolvChanged();
+    void reloadInstalledPackages();
 #ifdef QT_DEBUG
     void onTransactionFinished(quint32 exit, quint32 runtime);
     void emitError(quint32 code, const QString& details);
@@ -118,22 +129,30 @@ private slots:
     // Check for updates
 signals:
     void updatablePackagesChanged();
+    void updatablePackagesDiff(const QStringList &added, const QStringList &removed,
+                               const QStringList &changed);
 private slots:
     void getUpdates();
+    void getPkUpdates();
     void onPackageUpdate(quint32 info, const QString& packageId, const QString &summary);
     void onGetUpdatesFinished(quint32 status, quint32 runtime);
 
     // Package versions
 signals:
     void packageVersions(const QString &packageName, const QList<OrnPackageVersion> &versions);
+    void packageVersionsBatch(const OrnPackageVersionHash &versions);
 public slots:
     void getPackageVersions(const QString &packageName);
+    void getPackageVersionsBatch(const QStringList &packageNames);
+private slots:
+    void resolvePackageVersions();
 
     // Install package
 signals:
     void packageInstalled(const QString &packageName);
 public slots:
     void installPackage(const QString &packageId);
+    void installPackages(const QStringList &packageIds);
     void installFile(const QString &packageFile);
 private slots:
     void onPackageInstalled(quint32 exit, quint32 runtime);
@@ -143,6 +162,7 @@ signals:
     void packageRemoved(const QString &packageName);
 public slots:
     void removePackage(const QString &packageId, bool autoremove = false);
+    void removePackages(const QStringList &packageIds, bool autoremove = false);
 private slots:
     void onPackageRemoved(quint32 exit, quint32 runtime);
 
@@ -151,8 +171,11 @@ signals:
     void packageUpdated(const QString &packageName);
 public slots:
     void updatePackage(const QString &packageName);
+    void updatePackages(const QStringList &packageNames);
+    void updateAll();
 private slots:
     void onPackageUpdated(quint32 exit, quint32 runtime);
+    void onJobPackage(quint32 info, const QString &packageId, const QString &summary);
 
     // SSU repo actions
 signals:
@@ -166,11 +189,24 @@ public slots:
     void removeAllRepos();
 
     // Refresh repos
+public:
+    int refreshJobsLimit() const;
+    void setRefreshJobsLimit(int limit);
+    int refreshTimeout() const;
+    void setRefreshTimeout(int msec);
+    qreal refreshProgress() const;
+    Q_INVOKABLE QVariantMap refreshPlan() const;
+signals:
+    void refreshJobsLimitChanged();
+    void refreshTimeoutChanged();
+    void refreshProgressChanged();
+    void refreshReposFinished();
 public slots:
     void refreshRepo(const QString &repoAlias, bool force = false);
     void refreshRepos(bool force = false);
 private slots:
-    void refreshNextRepo(quint32 exit, quint32 runtime);
+    void refreshNextRepo();
+    void onRepoRefreshed(quint32 exit, quint32 runtime);
 
     // Get ORN repositories
 public:
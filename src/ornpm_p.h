@@ -27,53 +27,269 @@
 
 #define PK_FLAG_NONE  quint64(0)
 
+// Time in msec to keep a prefetched transaction before it is recreated
+#define PK_SPARE_TRANSACTION_TTL 60000
+// Number of finished transactions kept in the log
+#define PK_TRANSACTION_LOG_SIZE 100
+
 #define REPO_URL_TMPL  QStringLiteral("https://sailfish.openrepos.net/%0/personal/main")
 #define SOLV_PATH_TMPL QStringLiteral("/var/cache/zypp/solv/%0/solv")
 #define SOLV_INSTALLED "/var/cache/zypp/solv/@System/solv"
+#define SOLV_INSTALLED_ALIAS QStringLiteral("@System")
+// The zypp cookie file is touched on every refresh even if metadata has not changed
+#define RAW_COOKIE_TMPL QStringLiteral("/var/cache/zypp/raw/%0/cookie")
+
+// Time in msec to collect package versions requests before resolving them
+#define VERSIONS_COALESCE_INTERVAL 50
+// Time in msec to collect UpdatesChanged signals before checking for updates
+#define UPDATES_COALESCE_INTERVAL 500
+// Time in msec to wait after the installed solv file change before reloading it
+#define INSTALLED_RELOAD_DELAY 1000
+// Time in msec to collect transaction progress changes before notifying about them
+#define PROGRESS_COALESCE_INTERVAL 100
+
+// Default number of repos refreshed at the same time
+#define REFRESH_JOBS_LIMIT 4
+// Default time in msec to wait for a repo refresh before cancelling it
+#define REFRESH_TIMEOUT 120000
+// Time in msec without any progress after which a package job is considered lost
+#define PACKAGE_JOB_TIMEOUT 300000
+// Repos refreshed less than this number of seconds ago are not refreshed again
+#define REFRESH_MAX_AGE 3600
+// Initial estimates in msec of refresh times, they are updated with actual ones
+#define REFRESH_REPO_TIME 3000
+#define REFRESH_BULK_TIME 30000
+
+#define PM_SNAPSHOT_FILE    QStringLiteral("pmsnapshot")
+#define PM_SNAPSHOT_VERSION quint32(2)
 
 
 #include "ornpm.h"
 #include "orninstalledpackage.h"
+#include "orninstalledtable.h"
+#include "ornpktransaction.h"
 
 #include <QSet>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
 
 #include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusInterface>
 #include <QtDBus/QDBusPendingCallWatcher>
 
+#include <solv/pool.h>
+#include <solv/repo.h>
 
-struct OrnPmPrivate
-{
-    OrnPmPrivate(OrnPm *ornPm);
+#include <functional>
 
-    void initialise();
-    QDBusInterface *transaction(const QString &item = QString());
-    void preparePackageVersions(const QString &packageName);
-    void enableRepos(bool enable);
-    void removeAllRepos();
-    void onRepoModified(const QString &repoAlias, const OrnPm::RepoAction &action);
-    OrnInstalledPackageList prepareInstalledPackages(const QString &packageName);
 
+/*!
+    The package manager state shared between the GUI thread and workers.
+    It is never modified after it was published: the GUI thread makes a copy,
+    changes it and replaces the current one, while workers keep using the copy
+    they were started with.
+ */
+struct OrnPmState
+{
+    QSet<QString>   archs;
+    // <alias, enabled>
+    QHash<QString, bool> repos;
+    OrnInstalledTable installed;
+    // <name, package id>
+    QHash<QString, QString> updatable;
+};
+
+struct OrnPmPrivate
+{
     // <alias, enabled>
     typedef QHash<QString, bool>    RepoHash;
     typedef QSet<QString>           StringSet;
     typedef QHash<QString, QString> StringHash;
+    typedef QSharedPointer<const OrnPmState> StatePtr;
+
+    // A result of reloading the installed packages
+    struct InstalledDiff
+    {
+        InstalledDiff() : reloaded(false) {}
+
+        bool        reloaded;
+        OrnInstalledTable installed;
+        // Names of installed, removed and updated packages
+        QStringList changed;
+    };
+
+    // Names of packages which updates have appeared, disappeared or changed
+    struct UpdatesDiff
+    {
+        QStringList added;
+        QStringList removed;
+        QStringList changed;
+
+        inline bool isEmpty() const
+        {
+            return added.isEmpty() && removed.isEmpty() && changed.isEmpty();
+        }
+    };
+
+    // Packages waiting for a transaction to be processed with the operation
+    struct PackageJob
+    {
+        OrnPm::Operation operation;
+        QStringList ids;
+        bool        autoremove;
+    };
+
+    // A result of the initialisation to be applied in the GUI thread
+    struct Initialisation
+    {
+        Initialisation() : ok(false) {}
+
+        bool        ok;
+        StringSet   archs;
+        RepoHash    repos;
+        InstalledDiff installed;
+    };
+
+    // A repo loaded to the solv pool and the state of its solv file
+    struct SolvRepo
+    {
+        Repo    *repo;
+        qint64  mtime;
+        qint64  size;
+    };
+    // A solv file to be loaded to the pool
+    struct SolvFile
+    {
+        SolvFile() : mtime(0), size(0), map(nullptr), mapSize(0) {}
+
+        QString     alias;
+        QString     path;
+        qint64      mtime;
+        qint64      size;
+        // The file mapped to memory, it is unmapped after it is added to the pool
+        void        *map;
+        size_t      mapSize;
+    };
+    // <alias, repo>, the installed repo is stored with the SOLV_INSTALLED_ALIAS
+    typedef QHash<QString, SolvRepo> SolvRepoHash;
+    // <alias, <mtime, size>> of solv files
+    typedef QHash<QString, QPair<qint64, qint64>> SolvStampHash;
+    // <name id, solvable ids> for all repos in the pool
+    typedef QHash<Id, QVector<Id>> SolvNameIndex;
+
+    OrnPmPrivate(OrnPm *ornPm);
+    ~OrnPmPrivate();
+
+    Initialisation initialise(const StatePtr &current);
+    void finishInitialisation(const Initialisation &init);
+    QSharedPointer<OrnPmState> copyState() const;
+    void publishState(const QSharedPointer<OrnPmState> &newState);
+    bool loadSnapshot();
+    void saveSnapshot();
+    bool checkSolvRepo(const QString &alias, const QString &path, SolvFile &file);
+    static void mapSolvFile(SolvFile &file);
+    bool addSolvRepo(SolvFile &file);
+    bool syncSolvRepo(const QString &alias, const QString &path);
+    bool updateSolvPool(const OrnPmState &current);
+    void updateSolvIndex(const OrnPmState &current);
+    QSet<Id> ornNameIds() const;
+    OrnInstalledTable readInstalledPackages() const;
+    InstalledDiff reloadInstalledPackages(const OrnInstalledTable &current);
+    OrnPkTransaction *transaction(const QStringList &items = QStringList());
+    static UpdatesDiff diffUpdates(const StringHash &before, const StringHash &after);
+    StringHash computeUpdates(const StatePtr &current);
+    void estimateUpdates(bool confirm);
+    void applyUpdates(StringHash updatable);
+    void emitUpdatesDiff(const UpdatesDiff &diff);
+    void prefetchTransaction();
+    QHash<QString, OrnPkTransaction *> itemTransactions() const;
+    void logTransaction(OrnPkTransaction *transaction, quint32 exit, quint32 runtime);
+    void queuePackageJob(OrnPm::Operation operation, const QStringList &packageIds,
+                         bool autoremove = false);
+    void runPackageJob();
+    bool hasPackageJobs() const;
+    QStringList finishPackageOperations(QObject *transaction);
+    void applyPackageResults(OrnPm::Operation operation, const QStringList &ids);
+    OrnPackageVersionHash preparePackageVersions(const QStringList &packageNames,
+                                                 const StatePtr &current);
+    void callSsuBatch(const QString &method, const QList<QVariantList> &calls,
+                      const std::function<void(int)> &finished);
+    void onRepoModified(const QString &repoAlias, const OrnPm::RepoAction &action);
+    QStringList planRefresh(bool force, bool &bulk);
+    void startRefreshJob(const QString &alias);
+    void startBulkRefresh(const QStringList &aliases, bool force);
+    void finishRefreshJob(QObject *transaction);
+    OrnInstalledPackageList prepareInstalledPackages(const QString &packageName,
+                                                     const StatePtr &current);
 
     bool            initialised;
-    StringSet       archs;
+    // The state is loaded from the snapshot and is not revalidated yet
+    bool            stale;
     QDBusInterface  *ssuInterface;
+    QString         deviceModel;
     QDBusInterface  *pkInterface;
-    RepoHash        repos;
-    StringHash      installedPackages;
-    StringHash      updatablePackages;
+    // A transaction created in advance to be used by the next transaction() call
+    QString         pkSparePath;
+    QElapsedTimer   pkSpareTimer;
+    bool            pkPrefetching;
+    // Summaries of the last finished transactions
+    QList<QVariantMap> transactionLog;
+    // Must be read and replaced only in the GUI thread, workers get a copy when started
+    StatePtr        state;
     StringHash      newUpdatablePackages;
+    // Update checks are coalesced and only one is running at a time
+    QTimer          *updatesTimer;
+    bool            updatesRunning;
+    bool            updatesPending;
+    // Set when PackageKit returned updates, local results are then used only
+    // if no PackageKit check was started while they were computed
+    bool            updatesConfirmed;
+    quint32         updatesGeneration;
     QHash<QString, OrnPm::Operation> operations;
-    QHash<QObject *, QString> transactionHash;
+    // <transaction, ids of packages it processes>
+    QHash<QObject *, QStringList> transactionHash;
+    // Package jobs are run one at a time before repo refreshes
+    QList<PackageJob> packageJobs;
+    QObject         *packageJob;
+    // Repos waiting for refresh and <transaction, alias> of refreshes in progress
     QStringList     reposToRefresh;
-    QString         forceRefresh;
-#ifdef QT_DEBUG
-    quint64         refreshRuntime;
-#endif
+    QHash<QObject *, QString> refreshJobs;
+    // Queued repos which were requested to be refreshed with force
+    StringSet       reposToForce;
+    int             refreshJobsLimit;
+    int             refreshTimeout;
+    int             refreshTotal;
+    int             refreshFinished;
+    QElapsedTimer   refreshTimer;
+    // A single RefreshCache transaction and the repos it refreshes
+    QObject         *refreshBulkJob;
+    QStringList     refreshBulkRepos;
+    // Average refresh times in msec used by the planner
+    qint64          refreshRepoTime;
+    qint64          refreshBulkTime;
+    // The last refresh plan and its timings
+    QVariantMap     refreshPlan;
+    // The solv pool is long-lived and must be accessed only with the solvMutex locked
+    QMutex          solvMutex;
+    Pool            *solvPool;
+    SolvRepoHash    solvRepos;
+    // Solv files which could not be loaded, they are retried only after they change
+    SolvStampHash   solvFailed;
+    quint32         solvGeneration;
+    SolvNameIndex   solvNameIndex;
+    QSet<Id>        solvArchs;
+    quint32         solvIndexGeneration;
+    // Package versions requests waiting for the versionsTimer and being resolved now
+    StringSet       versionsRequested;
+    StringSet       versionsInFlight;
+    QTimer          *versionsTimer;
+    QFileSystemWatcher *installedWatcher;
+    QTimer          *installedTimer;
+    QTimer          *progressTimer;
 
 private:
     OrnPm *q_ptr;